@@ -33,6 +33,10 @@
 
 #include "config.h"
 #include "live/livequeue.h"
+#include "live/livesender.h"
+#include "live/timeshiftspace.h"
+#include "live/timeshiftstore.h"
+#include "net/uring.h"
 #include "recordings/recordingscache.h"
 
 cXVDRServerConfig::cXVDRServerConfig()
@@ -62,7 +66,14 @@ bool cXVDRServerConfig::Parse(const char* Name, const char* Value)
 {
   if     (!strcasecmp(Name, "TimeShiftDir")) cLiveQueue::SetTimeShiftDir(Value);
   else if(!strcasecmp(Name, "MaxTimeShiftSize")) cLiveQueue::SetBufferSize(strtoull(Value, NULL, 10));
+  else if(!strcasecmp(Name, "TimeShiftDirectIO")) cTimeShiftStore::SetDirectIO(atoi(Value) != 0);
+  else if(!strcasecmp(Name, "TimeShiftMemoryWindow")) cTimeShiftStore::SetMemoryWindow(atoi(Value));
+  else if(!strcasecmp(Name, "TimeShiftMemorySize")) cTimeShiftStore::SetMemorySize(strtoull(Value, NULL, 10));
+  else if(!strcasecmp(Name, "TimeShiftTotalSize")) cTimeShiftSpace::SetTotalSize(strtoull(Value, NULL, 10));
+  else if(!strcasecmp(Name, "TimeShiftMinFree")) cTimeShiftSpace::SetMinFree(strtoull(Value, NULL, 10));
+  else if(!strcasecmp(Name, "LiveSenderThreads")) cLiveSender::SetThreads(atoi(Value));
   else if(!strcasecmp(Name, "PiconsURL")) PiconsURL = Value;
+  else if(!strcasecmp(Name, "IoUring")) uring_enable(atoi(Value) != 0);
   else return false;
 
   return true;
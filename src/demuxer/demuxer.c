@@ -28,8 +28,9 @@
 #include <vdr/channels.h>
 
 #include "config/config.h"
-#include "live/livestreamer.h"
+#include "live/livesession.h"
 #include "demuxer.h"
+#include "tsscan.h"
 #include "demuxer_LATM.h"
 #include "demuxer_AC3.h"
 #include "demuxer_DTS.h"
@@ -129,14 +130,15 @@ int cParser::ParsePESHeader(uint8_t *buf, size_t len)
 
 // --- cTSDemuxer ----------------------------------------------------
 
-cTSDemuxer::cTSDemuxer(cLiveStreamer *streamer, eStreamType type, int pid)
-  : m_Streamer(streamer)
+cTSDemuxer::cTSDemuxer(cLiveSession *session, eStreamType type, int pid)
+  : m_Session(session)
   , m_streamType(type)
   , m_PID(pid)
   , m_parsed(false)
   , m_audiotype(0)
 {
   m_pesError        = false;
+  m_cc              = -1;
   m_pesParser       = NULL;
   m_language[0]     = 0;
   m_FpsScale        = 0;
@@ -272,7 +274,7 @@ void cTSDemuxer::SendPacket(sStreamPacket *pkt)
   pkt->pts      = Rescale(pts);
   pkt->duration = Rescale(pkt->duration);
 
-  m_Streamer->sendStreamPacket(pkt);
+  m_Session->sendStreamPacket(pkt);
 }
 
 bool cTSDemuxer::ProcessTSPacket(unsigned char *data)
@@ -280,24 +282,48 @@ bool cTSDemuxer::ProcessTSPacket(unsigned char *data)
   if (data == NULL)
     return false;
 
-  bool pusi  = TsPayloadStart(data);
-  int  bytes = TS_SIZE - TsPayloadOffset(data);
+  sTsHeader header;
+  if (TsScanHeaders(data, 1, &header) != 1)
+    return false;
+
+  return ProcessTSPacket(data, header);
+}
+
+bool cTSDemuxer::ProcessTSPacket(unsigned char *data, const sTsHeader& header)
+{
+  bool pusi  = (header.flags & TS_PAYLOAD_START);
+  int  bytes = TS_SIZE - header.offset;
 
   if(bytes < 0 || bytes > TS_SIZE)
     return false;
 
-  if (TsError(data))
+  if (header.flags & TS_ERROR)
   {
     ERRORLOG("transport error");
     return false;
   }
 
-  if (!TsHasPayload(data))
+  /* the continuity counter may jump at a signalled discontinuity (e.g. PCR or splice) */
+  if (header.flags & TS_SCAN_DISCONTINUITY)
+    m_cc = -1;
+
+  if (!(header.flags & TS_PAYLOAD_EXISTS))
   {
     DEBUGLOG("no payload, size %d", bytes);
     return true;
   }
 
+  /* packets got lost (e.g. on receiver overflows), drop the broken PES packet */
+  if (m_cc != -1 && header.cc != ((m_cc + 1) & TS_CONT_CNT_MASK))
+  {
+    /* duplicate packet */
+    if (header.cc == m_cc)
+      return true;
+
+    m_pesError = true;
+  }
+  m_cc = header.cc;
+
   /* drop broken PES packets */
   if (m_pesError && !pusi)
   {
@@ -341,7 +367,7 @@ void cTSDemuxer::SetVideoInformation(int FpsScale, int FpsRate, int Height, int
     return;
 
   // only register changed video information
-  if(Width == m_Width && Height == m_Height && Aspect == m_Aspect && m_Streamer->IsReady())
+  if(Width == m_Width && Height == m_Height && Aspect == m_Aspect && m_Session->IsReady())
     return;
 
   INFOLOG("--------------------------------------");
@@ -366,8 +392,8 @@ void cTSDemuxer::SetVideoInformation(int FpsScale, int FpsRate, int Height, int
   m_Aspect   = Aspect;
   m_parsed   = true;
 
-  if(m_Streamer->IsReady())
-    m_Streamer->RequestStreamChange();
+  if(m_Session->IsReady())
+    m_Session->RequestStreamChange();
 }
 
 void cTSDemuxer::SetAudioInformation(int Channels, int SampleRate, int BitRate, int BitsPerSample, int BlockAlign)
@@ -188,12 +188,16 @@ enum eStreamType
 #define PKT_P_FRAME 2
 #define PKT_B_FRAME 3
 #define PKT_NTYPES  4
+class MsgBuffer;
+
 struct sStreamPacket
 {
   sStreamPacket() {
     frametype = 0;
     type = stNONE;
     content = scNONE;
+    buffer = NULL;
+    serial = 0;
   }
 
   eStreamType type;
@@ -210,9 +214,14 @@ struct sStreamPacket
 
   uint8_t  *data;
   int       size;
+
+  MsgBuffer *buffer;  // shared buffer holding "data" (optional, enables zero-copy)
+
+  uint32_t   serial;  // set by the session, the same for all clients receiving the packet
 };
 
-class cLiveStreamer;
+class cLiveSession;
+struct sTsHeader;
 class cTSDemuxer;
 
 class cParser
@@ -241,13 +250,14 @@ protected:
 class cTSDemuxer
 {
 private:
-  cLiveStreamer        *m_Streamer;
+  cLiveSession         *m_Session;
   eStreamContent        m_streamContent;
   eStreamType           m_streamType;
   int                   m_PID;
   bool                  m_parsed;
 
   bool                  m_pesError;
+  int                   m_cc;           // continuity counter of the last packet (-1: none yet)
   cParser              *m_pesParser;
 
   char                  m_language[4];  // ISO 639 3-letter language code (empty string if undefined)
@@ -272,10 +282,11 @@ private:
   int64_t Rescale(int64_t a);
 
 public:
-  cTSDemuxer(cLiveStreamer *streamer, eStreamType type, int pid);
+  cTSDemuxer(cLiveSession *session, eStreamType type, int pid);
   virtual ~cTSDemuxer();
 
   bool ProcessTSPacket(unsigned char *data);
+  bool ProcessTSPacket(unsigned char *data, const sTsHeader& header);
   void SendPacket(sStreamPacket *pkt);
 
   void SetLanguageDescriptor(const char *language, uint8_t atype);
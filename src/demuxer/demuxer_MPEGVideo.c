@@ -26,7 +26,8 @@
 #include <assert.h>
 
 #include "config/config.h"
-#include "live/livestreamer.h"
+#include "net/msgbuffer.h"
+#include "live/livesession.h"
 #include "bitstream.h"
 #include "demuxer_MPEGVideo.h"
 
@@ -56,6 +57,7 @@ const unsigned int mpeg2video_framedurations[16] = {
 cParserMPEG2Video::cParserMPEG2Video(cTSDemuxer *demuxer)
  : cParser(demuxer)
 {
+  m_frame             = NULL;
   m_pictureBuffer     = NULL;
   m_pictureBufferSize = 0;
   m_pictureBufferPtr  = 0;
@@ -71,9 +73,10 @@ cParserMPEG2Video::cParserMPEG2Video(cTSDemuxer *demuxer)
 
 cParserMPEG2Video::~cParserMPEG2Video()
 {
-  if (m_pictureBuffer)
+  if (m_frame)
   {
-    free(m_pictureBuffer);
+    m_frame->unref();
+    m_frame = NULL;
     m_pictureBuffer = NULL;
   }
 }
@@ -82,23 +85,35 @@ void cParserMPEG2Video::Parse(unsigned char *data, int size, bool pusi)
 {
   uint32_t startcode = m_StartCond;
 
-  if (m_pictureBuffer == NULL)
+  if (m_frame == NULL)
   {
-    m_pictureBufferSize   = 4000;
-    m_pictureBuffer       = (uint8_t*)malloc(m_pictureBufferSize);
+    m_frame               = MsgBuffer::create(4000);
+    m_pictureBufferSize   = (m_frame != NULL) ? 4000 : 0;
+    m_pictureBuffer       = (m_frame != NULL) ? m_frame->data() : NULL;
+  }
+
+  // out of memory, the data is lost
+  if (m_frame == NULL)
+  {
+    DropFrame();
+    return;
   }
 
   if (m_pictureBufferPtr + size + 4 >= m_pictureBufferSize)
   {
+    if (!m_frame->resize(m_pictureBufferSize + size * 4))
+    {
+      ERRORLOG("MPEG2 Video unable to grow the picture buffer, frame dropped");
+      DropFrame();
+      return;
+    }
+
     m_pictureBufferSize  += size * 4;
-    m_pictureBuffer       = (uint8_t*)realloc(m_pictureBuffer, m_pictureBufferSize);
+    m_pictureBuffer       = m_frame->data();
   }
 
   for (int i = 0; i < size; i++)
   {
-    if (!m_pictureBuffer)
-      break;
-
     m_pictureBuffer[m_pictureBufferPtr++] = data[i];
     startcode = startcode << 8 | data[i];
 
@@ -111,6 +126,14 @@ void cParserMPEG2Video::Parse(unsigned char *data, int size, bool pusi)
       reset = Parse_MPEG2Video(m_pictureBufferPtr - 4, startcode, m_StartCodeOffset);
     }
 
+    // no new buffer after the frame has been sent
+    if (m_frame == NULL)
+    {
+      DropFrame();
+      m_StartCond = 0;
+      return;
+    }
+
     if (reset)
     {
       /* Reset packet parser upon length error or if parser tells us so */
@@ -126,6 +149,15 @@ void cParserMPEG2Video::Parse(unsigned char *data, int size, bool pusi)
   m_StartCond = startcode;
 }
 
+void cParserMPEG2Video::DropFrame()
+{
+  delete m_StreamPacket;
+  m_StreamPacket      = NULL;
+  m_FoundFrame        = false;
+  m_pictureBufferPtr  = 0;
+  m_StartCode         = 0;
+}
+
 bool cParserMPEG2Video::Parse_MPEG2Video(size_t len, uint32_t next_startcode, int sc_offset)
 {
   int frametype;
@@ -195,6 +227,7 @@ bool cParserMPEG2Video::Parse_MPEG2Video(size_t len, uint32_t next_startcode, in
         m_StreamPacket->data      = m_pictureBuffer;
         m_StreamPacket->size      = m_pictureBufferPtr - 4;
         m_StreamPacket->duration  = m_FrameDuration;
+        m_StreamPacket->buffer    = m_frame;
 
         // check if packet has a valid PTS
         if(m_StreamPacket->pts == DVD_NOPTS_VALUE)
@@ -203,11 +236,19 @@ bool cParserMPEG2Video::Parse_MPEG2Video(size_t len, uint32_t next_startcode, in
         m_demuxer->SendPacket(m_StreamPacket);
 
         // remove packet
-        free(m_StreamPacket->data);
         delete m_StreamPacket;
         m_StreamPacket = NULL;
 
-        m_pictureBuffer = (uint8_t*)malloc(m_pictureBufferSize);
+        // the frame is still referenced by the queued packet, continue with a new buffer
+        if (m_frame->shared())
+        {
+          m_frame->unref();
+          m_frame         = MsgBuffer::create(m_pictureBufferSize);
+          m_pictureBuffer = (m_frame != NULL) ? m_frame->data() : NULL;
+
+          if (m_frame == NULL)
+            ERRORLOG("MPEG2 Video unable to allocate a new picture buffer");
+        }
 
         /* If we know the frame duration, increase DTS accordingly */
         m_curDTS += m_FrameDuration;
@@ -35,6 +35,7 @@ class cBitstream;
 class cParserMPEG2Video : public cParser
 {
 private:
+  MsgBuffer      *m_frame;
   uint8_t        *m_pictureBuffer;
   int             m_pictureBufferSize;
   int             m_pictureBufferPtr;
@@ -47,6 +48,7 @@ private:
   int             m_vbvSize;        /* Video buffer size (in bytes) */
   bool            m_FoundFrame;
 
+  void DropFrame();
   bool Parse_MPEG2Video(size_t len, uint32_t next_startcode, int sc_offset);
   bool Parse_MPEG2Video_SeqStart(cBitstream *bs);
   bool Parse_MPEG2Video_PicStart(int *frametype, cBitstream *bs);
@@ -26,7 +26,8 @@
 #include <assert.h>
 
 #include "config/config.h"
-#include "live/livestreamer.h"
+#include "net/msgbuffer.h"
+#include "live/livesession.h"
 #include "bitstream.h"
 #include "demuxer_h264.h"
 
@@ -53,6 +54,7 @@ static const int h264_lev2cpbsize[][2] =
 cParserH264::cParserH264(cTSDemuxer *demuxer)
  : cParser(demuxer)
 {
+  m_frame             = NULL;
   m_pictureBuffer     = NULL;
   m_pictureBufferSize = 0;
   m_pictureBufferPtr  = 0;
@@ -74,24 +76,39 @@ cParserH264::cParserH264(cTSDemuxer *demuxer)
 
 cParserH264::~cParserH264()
 {
-  if (m_pictureBuffer)
-    free(m_pictureBuffer);
+  if (m_frame)
+    m_frame->unref();
 }
 
 void cParserH264::Parse(unsigned char *data, int size, bool pusi)
 {
   uint32_t startcode = m_StartCond;
 
-  if (m_pictureBuffer == NULL)
+  if (m_frame == NULL)
   {
-    m_pictureBufferSize   = 80000;
-    m_pictureBuffer       = (uint8_t*)malloc(m_pictureBufferSize);
+    m_frame               = MsgBuffer::create(80000);
+    m_pictureBufferSize   = (m_frame != NULL) ? 80000 : 0;
+    m_pictureBuffer       = (m_frame != NULL) ? m_frame->data() : NULL;
+  }
+
+  // out of memory, the data is lost
+  if (m_frame == NULL)
+  {
+    DropFrame();
+    return;
   }
 
   if (m_pictureBufferPtr + size + 4 >= m_pictureBufferSize)
   {
+    if (!m_frame->resize(m_pictureBufferSize + size * 4))
+    {
+      ERRORLOG("H264 unable to grow the picture buffer, frame dropped");
+      DropFrame();
+      return;
+    }
+
     m_pictureBufferSize  += size * 4;
-    m_pictureBuffer       = (uint8_t*)realloc(m_pictureBuffer, m_pictureBufferSize);
+    m_pictureBuffer       = m_frame->data();
   }
 
   for (int i = 0; i < size; i++)
@@ -108,6 +125,14 @@ void cParserH264::Parse(unsigned char *data, int size, bool pusi)
       reset = Parse_H264(m_pictureBufferPtr - 4, startcode, m_StartCodeOffset);
     }
 
+    // no new buffer after the frame has been sent
+    if (m_frame == NULL)
+    {
+      DropFrame();
+      m_StartCond = 0;
+      return;
+    }
+
     if (reset)
     {
       /* Reset packet parser upon length error or if parser tells us so */
@@ -123,6 +148,13 @@ void cParserH264::Parse(unsigned char *data, int size, bool pusi)
   m_StartCond = startcode;
 }
 
+void cParserH264::DropFrame()
+{
+  m_FoundFrame        = false;
+  m_pictureBufferPtr  = 0;
+  m_StartCode         = 0;
+}
+
 bool cParserH264::Parse_H264(size_t len, uint32_t next_startcode, int sc_offset)
 {
   uint8_t nal_data[len];
@@ -209,10 +241,23 @@ bool cParserH264::Parse_H264(size_t len, uint32_t next_startcode, int sc_offset)
       return true;
 
     // send packet
-    m_FoundFrame        = false;
-    m_StreamPacket.data = m_pictureBuffer;
-    m_StreamPacket.size = m_pictureBufferPtr;
+    m_FoundFrame          = false;
+    m_StreamPacket.data   = m_pictureBuffer;
+    m_StreamPacket.size   = m_pictureBufferPtr;
+    m_StreamPacket.buffer = m_frame;
     m_demuxer->SendPacket(&m_StreamPacket);
+    m_StreamPacket.buffer = NULL;
+
+    // the frame is still referenced by the queued packet, continue with a new buffer
+    if (m_frame->shared())
+    {
+      m_frame->unref();
+      m_frame         = MsgBuffer::create(m_pictureBufferSize);
+      m_pictureBuffer = (m_frame != NULL) ? m_frame->data() : NULL;
+
+      if (m_frame == NULL)
+        ERRORLOG("H264 unable to allocate a new picture buffer");
+    }
 
     return true;
   }
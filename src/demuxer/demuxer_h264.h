@@ -64,6 +64,7 @@ private:
     NAL_END_SEQ = 0x0A  // End of Sequence
   };
 
+  MsgBuffer      *m_frame;
   uint8_t        *m_pictureBuffer;
   int             m_pictureBufferSize;
   int             m_pictureBufferPtr;
@@ -82,6 +83,7 @@ private:
   bool            m_firstIFrame;
   bool            m_FoundFrame;
 
+  void DropFrame();
   bool Parse_H264(size_t len, uint32_t next_startcode, int sc_offset);
   bool Parse_PPS(uint8_t *buf, int len);
   bool Parse_SLH(uint8_t *buf, int len, int *pkttype);
@@ -0,0 +1,85 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "tsscan.h"
+
+int TsSync(const uchar *data, int size)
+{
+  // the last offset that can be checked against the next packet
+  int end = size - TS_SIZE;
+  int i = 0;
+
+  if(end <= 0)
+    return 0;
+
+#ifdef __SSE2__
+  // test 16 offsets at once for a sync byte at i and i + TS_SIZE
+  const __m128i sync = _mm_set1_epi8(TS_SYNC_BYTE);
+
+  for(; i + 16 <= end; i += 16)
+  {
+    __m128i a = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i)), sync);
+    __m128i b = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i + TS_SIZE)), sync);
+    int mask = _mm_movemask_epi8(_mm_and_si128(a, b));
+
+    if(mask != 0)
+      return i + __builtin_ctz(mask);
+  }
+#endif
+
+  for(; i < end; i++)
+  {
+    if(data[i] == TS_SYNC_BYTE && data[i + TS_SIZE] == TS_SYNC_BYTE)
+      return i;
+  }
+
+  return end;
+}
+
+int TsScanHeaders(const uchar *data, int count, sTsHeader *headers)
+{
+  for(int i = 0; i < count; i++, data += TS_SIZE)
+  {
+    if(data[0] != TS_SYNC_BYTE)
+      return i;
+
+    sTsHeader& h = headers[i];
+
+    h.pid    = ((data[1] & 0x1F) << 8) | data[2];
+    h.flags  = (data[1] & (TS_ERROR | TS_PAYLOAD_START)) | (data[3] & (TS_ADAPT_FIELD_EXISTS | TS_PAYLOAD_EXISTS));
+    h.cc     = data[3] & TS_CONT_CNT_MASK;
+    h.offset = (data[3] & TS_ADAPT_FIELD_EXISTS) ? data[4] + 5 : 4;
+
+    // signalled discontinuity (the adaptation field flags follow its length)
+    if((data[3] & TS_ADAPT_FIELD_EXISTS) && data[4] > 0 && (data[5] & TS_ADAPT_DISCONT))
+      h.flags |= TS_SCAN_DISCONTINUITY;
+  }
+
+  return count;
+}
@@ -0,0 +1,53 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#ifndef XVDR_TSSCAN_H
+#define XVDR_TSSCAN_H
+
+#include <stdint.h>
+#include <vdr/remux.h>
+
+// discontinuity_indicator of the adaptation field (sTsHeader flags only)
+#define TS_SCAN_DISCONTINUITY 0x01
+
+// TS header fields of a packet, classified by TsScanHeaders()
+
+struct sTsHeader
+{
+  uint16_t pid;
+  uint16_t offset;    // payload offset (> TS_SIZE if the adaptation field is broken)
+  uint8_t  flags;     // TS_ERROR | TS_PAYLOAD_START | TS_ADAPT_FIELD_EXISTS | TS_PAYLOAD_EXISTS | TS_SCAN_DISCONTINUITY
+  uint8_t  cc;        // continuity counter
+};
+
+// offset of the first packet followed by another sync byte (SSE2 assisted).
+// Returns size - TS_SIZE if there is none.
+int TsSync(const uchar *data, int size);
+
+// classify the headers of up to "count" consecutive packets. Stops at the
+// first packet without a sync byte, returns the number of classified packets.
+int TsScanHeaders(const uchar *data, int count, sTsHeader *headers);
+
+#endif // XVDR_TSSCAN_H
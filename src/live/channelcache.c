@@ -22,10 +22,12 @@
  *
  */
 
+#include <vector>
+
 #include "config/config.h"
 #include "channelcache.h"
-#include "livestreamer.h"
-#include "livereceiver.h"
+#include "livesession.h"
+#include "livehub.h"
 
 cMutex cChannelCache::m_access;
 std::map<uint32_t, cChannelCache> cChannelCache::m_cache;
@@ -43,32 +45,31 @@ void cChannelCache::AddStream(const struct StreamInfo& s) {
   m_bChanged = (old != s);
 }
 
-void cChannelCache::CreateDemuxers(cLiveStreamer* streamer) {
-  streamer->Detach();
-
+void cChannelCache::CreateDemuxers(cLiveSession* session) {
   // remove old demuxers
-  for (std::list<cTSDemuxer*>::iterator i = streamer->m_Demuxers.begin(); i != streamer->m_Demuxers.end(); i++)
+  for (std::list<cTSDemuxer*>::iterator i = session->m_Demuxers.begin(); i != session->m_Demuxers.end(); i++)
     delete *i;
 
-  streamer->m_Demuxers.clear();
-  streamer->m_Receiver->SetPids(NULL);
+  session->m_Demuxers.clear();
 
   // create new stream demuxers
+  std::vector<int> pids;
   for (iterator i = begin(); i != end(); i++)
   {
     StreamInfo& info = i->second;
-    cTSDemuxer* dmx = CreateDemuxer(streamer, info);
+    cTSDemuxer* dmx = CreateDemuxer(session, info);
     if (dmx != NULL)
     {
-      streamer->m_Demuxers.push_back(dmx);
-      streamer->m_Receiver->AddPid(info.pid);
+      session->m_Demuxers.push_back(dmx);
+      pids.push_back(info.pid);
     }
   }
 
-  streamer->Attach();
+  session->UpdatePidTable();
+  session->m_Hub->SetPids(session, pids);
 }
 
-cTSDemuxer* cChannelCache::CreateDemuxer(cLiveStreamer* streamer, const struct StreamInfo& info) const {
+cTSDemuxer* cChannelCache::CreateDemuxer(cLiveSession* session, const struct StreamInfo& info) const {
   cTSDemuxer* stream = NULL;
   cCamSlot* cam = NULL;
 
@@ -77,7 +78,7 @@ cTSDemuxer* cChannelCache::CreateDemuxer(cLiveStreamer* streamer, const struct S
     // hande video streams
     case stMPEG2VIDEO:
     case stH264:
-      stream = new cTSDemuxer(streamer, info.type, info.pid);
+      stream = new cTSDemuxer(session, info.type, info.pid);
       if(info.width != 0 && info.height != 0)
       {
         INFOLOG("Setting cached video information");
@@ -92,26 +93,26 @@ cTSDemuxer* cChannelCache::CreateDemuxer(cLiveStreamer* streamer, const struct S
     case stDTS:
     case stAAC:
     case stLATM:
-      stream = new cTSDemuxer(streamer, info.type, info.pid);
+      stream = new cTSDemuxer(session, info.type, info.pid);
       stream->SetLanguageDescriptor(info.lang, info.audioType);
       break;
 
     // subtitles
     case stDVBSUB:
-      stream = new cTSDemuxer(streamer, info.type, info.pid);
+      stream = new cTSDemuxer(session, info.type, info.pid);
       stream->SetLanguageDescriptor(info.lang, info.audioType);
       stream->SetSubtitlingDescriptor(info.subtitlingType, info.compositionPageId, info.ancillaryPageId);
       break;
 
     // teletext
     case stTELETEXT:
-      stream = new cTSDemuxer(streamer, info.type, info.pid);
+      stream = new cTSDemuxer(session, info.type, info.pid);
 
       // add teletext pid if there is a CAM connected
       // (some broadcasters encrypt teletext data)
-      cam = streamer->m_Device->CamSlot();
+      cam = session->m_Device->CamSlot();
       if(cam != NULL)
-        cam->AddPid(streamer->m_Channel->Sid(), info.pid, 0x06);
+        cam->AddPid(session->m_Channel->Sid(), info.pid, 0x06);
 
       break;
 
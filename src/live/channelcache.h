@@ -31,7 +31,7 @@
 #include <map>
 #include <string.h>
 
-class cLiveStreamer;
+class cLiveSession;
 
 struct StreamInfo {
   StreamInfo() {
@@ -83,9 +83,9 @@ public:
 
   void AddStream(const struct StreamInfo& s);
 
-  void CreateDemuxers(cLiveStreamer* streamer);
+  void CreateDemuxers(cLiveSession* session);
 
-  cTSDemuxer* CreateDemuxer(cLiveStreamer* streamer, const struct StreamInfo& s) const;
+  cTSDemuxer* CreateDemuxer(cLiveSession* session, const struct StreamInfo& s) const;
 
   bool operator ==(const cChannelCache& c) const;
 
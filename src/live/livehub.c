@@ -0,0 +1,428 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#include <string.h>
+#include <algorithm>
+#include <vdr/remux.h>
+
+#include "config/config.h"
+
+#include "livehub.h"
+#include "livepatfilter.h"
+#include "livereceiver.h"
+#include "livesession.h"
+
+// cDevice only opens the pids of a receiver while attaching it. The pid
+// handling is protected, this opens and closes single pids of an attached
+// receiver.
+class cHubDevice : public cDevice
+{
+public:
+
+  static bool OpenPid(cDevice* device, int pid)
+  {
+    return (device->*(&cHubDevice::AddPid))(pid, ptOther, 0);
+  }
+
+  static void ClosePid(cDevice* device, int pid)
+  {
+    (device->*(&cHubDevice::DelPid))(pid, ptOther);
+  }
+};
+
+std::list<cLiveHub*> cLiveHub::m_hubs;
+
+cMutex cLiveHub::m_hubsLock;
+
+cLiveHub::cLiveHub(cDevice* device, const cChannel* channel, int priority) : m_device(device), m_source(channel->Source()), m_transponder(channel->Transponder()),
+  m_receiverPriority(priority), m_priorityReceiver(NULL), m_priority(priority), m_hasRetired(0), m_refs(0)
+{
+  m_routes = new tRoute*[PidTableSize];
+  memset(m_routes, 0, PidTableSize * sizeof(tRoute*));
+
+  m_receiver = new cLiveReceiver(this, priority);
+  m_patFilter = new cLivePatFilter;
+
+  DEBUGLOG("Starting PAT scanner");
+  m_device->AttachFilter(m_patFilter);
+}
+
+cLiveHub::~cLiveHub()
+{
+  DEBUGLOG("Detaching Live Receiver");
+  RebuildReceiver(NULL);
+
+  if(m_priorityReceiver != NULL)
+  {
+    m_device->Detach(m_priorityReceiver);
+    delete m_priorityReceiver;
+  }
+
+  DEBUGLOG("Detaching Live Filter");
+  m_device->Detach(m_patFilter);
+
+  delete m_receiver;
+  delete m_patFilter;
+
+  FreeRetired();
+  FreeRoutes(m_routes);
+}
+
+cLiveHub* cLiveHub::Acquire(cDevice* device, const cChannel* channel, cLiveSession* session, int priority)
+{
+  cMutexLock lock(&m_hubsLock);
+
+  for(std::list<cLiveHub*>::iterator i = m_hubs.begin(); i != m_hubs.end(); i++)
+  {
+    cLiveHub* hub = *i;
+
+    if(hub->m_device == device && hub->m_source == channel->Source() && hub->m_transponder == channel->Transponder())
+    {
+      hub->m_refs++;
+      INFOLOG("Sharing the receiver of device %d (%i channels)", device->DeviceNumber() + 1, hub->m_refs);
+      hub->SetPriority(session, priority);
+      return hub;
+    }
+  }
+
+  cLiveHub* hub = new cLiveHub(device, channel, priority);
+  hub->m_refs = 1;
+  hub->SetPriority(session, priority);
+  m_hubs.push_back(hub);
+
+  return hub;
+}
+
+void cLiveHub::Release(cLiveHub* hub)
+{
+  if(hub == NULL)
+    return;
+
+  cMutexLock lock(&m_hubsLock);
+
+  if(--hub->m_refs > 0)
+    return;
+
+  m_hubs.remove(hub);
+  delete hub;
+}
+
+void cLiveHub::AddService(cLiveSession* session, const cChannel* channel)
+{
+  m_patFilter->AddService(session, channel);
+}
+
+void cLiveHub::SetPids(cLiveSession* session, const std::vector<int>& pids)
+{
+  cMutexLock lock(&m_lock);
+
+  m_pids[session] = pids;
+  UpdateReceiver();
+}
+
+void cLiveHub::SetPriority(cLiveSession* session, int priority)
+{
+  cMutexLock lock(&m_lock);
+
+  m_priorities[session] = priority;
+  UpdatePriority();
+}
+
+void cLiveHub::Remove(cLiveSession* session)
+{
+  // the filter must not call the session anymore
+  m_patFilter->RemoveService(session);
+
+  cMutexLock lock(&m_lock);
+
+  if(m_pids.erase(session) > 0)
+    UpdateReceiver();
+
+  if(m_priorities.erase(session) > 0)
+    UpdatePriority();
+}
+
+void cLiveHub::UpdatePriority()
+{
+  int priority = m_receiverPriority;
+
+  for(std::map<cLiveSession*, int>::iterator i = m_priorities.begin(); i != m_priorities.end(); i++)
+    priority = std::max(priority, i->second);
+
+  if(priority == m_priority)
+    return;
+
+  cLiveReceiver* receiver = NULL;
+
+  // attach the new one first, the device priority never drops in between
+  if(priority > m_receiverPriority)
+  {
+    receiver = new cLiveReceiver(this, priority);
+
+    if(!m_device->AttachReceiver(receiver))
+    {
+      ERRORLOG("Unable to raise the priority of device %d to %i", m_device->DeviceNumber() + 1, priority);
+      delete receiver;
+      return;
+    }
+  }
+
+  if(m_priorityReceiver != NULL)
+  {
+    m_device->Detach(m_priorityReceiver);
+    delete m_priorityReceiver;
+  }
+
+  DEBUGLOG("Priority of the receiver of device %d changed from %i to %i", m_device->DeviceNumber() + 1, m_priority, priority);
+
+  m_priorityReceiver = receiver;
+  m_priority = priority;
+}
+
+void cLiveHub::UpdateReceiver()
+{
+  tRoute** routes = new tRoute*[PidTableSize];
+  memset(routes, 0, PidTableSize * sizeof(tRoute*));
+
+  int added = 0;
+
+  for(std::map<cLiveSession*, std::vector<int> >::iterator i = m_pids.begin(); i != m_pids.end(); i++)
+  {
+    for(std::vector<int>::const_iterator pid = i->second.begin(); pid != i->second.end(); pid++)
+    {
+      int p = *pid & (PidTableSize - 1);
+
+      if(routes[p] == NULL)
+      {
+        routes[p] = new tRoute;
+
+        if(m_receiverPids.find(p) == m_receiverPids.end())
+          added++;
+      }
+
+      routes[p]->push_back(i->first);
+    }
+  }
+
+  // no room for the new pids, drop the closed ones (this interrupts the stream)
+  if((int)m_receiverPids.size() + added > MAXRECEIVEPIDS)
+  {
+    RebuildReceiver(routes);
+    return;
+  }
+
+  bool attached = m_receiver->IsAttached();
+
+  // open the new pids before they are routed
+  for(int p = 0; p < PidTableSize; p++)
+  {
+    if(routes[p] == NULL)
+      continue;
+
+    std::map<int, bool>::iterator i = m_receiverPids.find(p);
+
+    if(i == m_receiverPids.end())
+    {
+      if(!m_receiver->AddPid(p))
+      {
+        ERRORLOG("Unable to receive pid %i (too many pids on the transponder)", p);
+        delete routes[p];
+        routes[p] = NULL;
+        continue;
+      }
+
+      i = m_receiverPids.insert(std::make_pair(p, false)).first;
+    }
+
+    if(attached && !i->second && !cHubDevice::OpenPid(m_device, p))
+      ERRORLOG("Unable to open pid %i on device %d", p, m_device->DeviceNumber() + 1);
+
+    i->second = true;
+  }
+
+  SetRoutes(routes);
+
+  // attaching opens all pids of the list
+  if(!attached && !m_pids.empty())
+  {
+    m_device->AttachReceiver(m_receiver);
+
+    for(std::map<int, bool>::iterator i = m_receiverPids.begin(); i != m_receiverPids.end(); i++)
+      i->second = true;
+
+    attached = m_receiver->IsAttached();
+  }
+
+  // close the pids nobody receives anymore
+  if(!attached)
+    return;
+
+  for(std::map<int, bool>::iterator i = m_receiverPids.begin(); i != m_receiverPids.end(); i++)
+  {
+    if(i->second && routes[i->first] == NULL)
+    {
+      cHubDevice::ClosePid(m_device, i->first);
+      i->second = false;
+    }
+  }
+}
+
+void cLiveHub::RebuildReceiver(tRoute** routes)
+{
+  // the device closes all pids of the list when the receiver is detached,
+  // the closed ones must not be closed twice
+  if(m_receiver->IsAttached())
+  {
+    m_receiver->SetPids(NULL);
+
+    for(std::map<int, bool>::iterator i = m_receiverPids.begin(); i != m_receiverPids.end(); i++)
+    {
+      if(i->second)
+        m_receiver->AddPid(i->first);
+    }
+
+    m_device->Detach(m_receiver);
+  }
+
+  m_receiver->SetPids(NULL);
+  m_receiverPids.clear();
+
+  if(routes == NULL)
+    return;
+
+  for(int p = 0; p < PidTableSize; p++)
+  {
+    if(routes[p] == NULL)
+      continue;
+
+    if(!m_receiver->AddPid(p))
+    {
+      ERRORLOG("Unable to receive pid %i (too many pids on the transponder)", p);
+      delete routes[p];
+      routes[p] = NULL;
+      continue;
+    }
+
+    m_receiverPids[p] = true;
+  }
+
+  // Receive() isn't running while the receiver is detached
+  tRoute** old = m_routes;
+
+  __sync_synchronize();
+  m_routes = routes;
+
+  FreeRetired();
+  FreeRoutes(old);
+
+  if(!m_pids.empty())
+    m_device->AttachReceiver(m_receiver);
+}
+
+void cLiveHub::SetRoutes(tRoute** routes)
+{
+  tRoute** old = m_routes;
+
+  __sync_synchronize();
+  m_routes = routes;
+
+  // Receive() may still be using the old table
+  cMutexLock lock(&m_retiredLock);
+  m_retired.push_back(old);
+  m_hasRetired = 1;
+}
+
+void cLiveHub::FreeRetired()
+{
+  std::vector<tRoute**> retired;
+
+  m_retiredLock.Lock();
+  retired.swap(m_retired);
+  m_hasRetired = 0;
+  m_retiredLock.Unlock();
+
+  for(std::vector<tRoute**>::iterator i = retired.begin(); i != retired.end(); i++)
+    FreeRoutes(*i);
+}
+
+void cLiveHub::FreeRoutes(tRoute** routes)
+{
+  for(int i = 0; i < PidTableSize; i++)
+    delete routes[i];
+
+  delete[] routes;
+}
+
+void cLiveHub::Receive(uchar *Data, int Length)
+{
+  // the device calls Receive() under its receiver mutex, one call at a time.
+  // tables replaced before this call are no longer used.
+  if(m_hasRetired)
+    FreeRetired();
+
+  tRoute** routes = m_routes;
+
+  for(; Length >= TS_SIZE; Data += TS_SIZE, Length -= TS_SIZE)
+  {
+    tRoute* route = routes[TsPid(Data)];
+
+    if(route == NULL)
+      continue;
+
+    for(tRoute::iterator i = route->begin(); i != route->end(); i++)
+      (*i)->Put(Data, TS_SIZE);
+  }
+}
+
+void cLiveHub::Activate(bool On)
+{
+  // the session threads run independently of the receiver
+  DEBUGLOG("Live receiver of device %d %s", m_device->DeviceNumber() + 1, On ? "activated" : "deactivated");
+}
+
+cString cLiveHub::Status()
+{
+  cMutexLock lock(&m_hubsLock);
+
+  cString status = cString::sprintf("Receivers: %i\n", (int)m_hubs.size());
+
+  for(std::list<cLiveHub*>::iterator i = m_hubs.begin(); i != m_hubs.end(); i++)
+  {
+    cLiveHub* hub = *i;
+    cMutexLock hublock(&hub->m_lock);
+
+    int pids = 0;
+    for(int p = 0; p < PidTableSize; p++)
+    {
+      if(hub->m_routes[p] != NULL)
+        pids++;
+    }
+
+    status = cString::sprintf("%sDevice %d, transponder %d: %i channel(s), %i pids, priority %i\n", (const char*)status,
+      hub->m_device->DeviceNumber() + 1, hub->m_transponder, hub->m_refs, pids, hub->m_priority);
+  }
+
+  return status;
+}
@@ -0,0 +1,158 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#ifndef XVDR_LIVEHUB_H
+#define XVDR_LIVEHUB_H
+
+#include <stdint.h>
+#include <list>
+#include <map>
+#include <vector>
+#include <vdr/channels.h>
+#include <vdr/device.h>
+#include <vdr/thread.h>
+
+class cLiveReceiver;
+class cLivePatFilter;
+class cLiveSession;
+
+// Demux hub of a transponder. All live sessions receiving channels of the
+// same transponder on the same device share one receiver (with the pids of
+// all sessions) and one PAT / PMT scanner. The hub routes every TS packet
+// to the sessions demuxing its pid.
+
+class cLiveHub
+{
+public:
+
+  // get the hub of the channel's transponder on a device (created if it doesn't exist)
+  static cLiveHub* Acquire(cDevice* device, const cChannel* channel, cLiveSession* session, int priority);
+
+  // drop a reference (the hub is detached and deleted with the last one)
+  static void Release(cLiveHub* hub);
+
+  // scan the PMT of the session's channel
+  void AddService(cLiveSession* session, const cChannel* channel);
+
+  // set the pids routed to a session (replaces the previous ones)
+  void SetPids(cLiveSession* session, const std::vector<int>& pids);
+
+  // set the priority of a session, the receiver keeps the highest one
+  void SetPriority(cLiveSession* session, int priority);
+
+  // stop scanning and routing for a session
+  void Remove(cLiveSession* session);
+
+  // receiver thread
+  void Receive(uchar *Data, int Length);
+
+  void Activate(bool On);
+
+  // report of all hubs (SVDRP)
+  static cString Status();
+
+  enum
+  {
+    PidTableSize = 8192       // 13 bit TS pids
+  };
+
+private:
+
+  typedef std::vector<cLiveSession*> tRoute;
+
+  cLiveHub(cDevice* device, const cChannel* channel, int priority);
+
+  ~cLiveHub();
+
+  // open and close pids on the attached receiver, so the other sessions
+  // keep receiving (m_lock held)
+  void UpdateReceiver();
+
+  // reattach the receiver with the pids in use only (m_lock held)
+  void RebuildReceiver(tRoute** routes);
+
+  // publish a new route table, the old one is freed by Receive()
+  void SetRoutes(tRoute** routes);
+
+  // free the replaced route tables (receiver thread or detached receiver)
+  void FreeRetired();
+
+  static void FreeRoutes(tRoute** routes);
+
+  // hold the device with the highest session priority (m_lock held)
+  void UpdatePriority();
+
+  cDevice* m_device;
+
+  int m_source;
+
+  int m_transponder;
+
+  cLiveReceiver* m_receiver;
+
+  cLivePatFilter* m_patFilter;
+
+  // priority the receiver was created with
+  int m_receiverPriority;
+
+  // receiver without pids raising the device priority above m_receiverPriority.
+  // the device uses the highest priority of its receivers, replacing the
+  // receiver itself would interrupt all streams.
+  cLiveReceiver* m_priorityReceiver;
+
+  int m_priority;
+
+  // pids of each session
+  std::map<cLiveSession*, std::vector<int> > m_pids;
+
+  // priority of each session
+  std::map<cLiveSession*, int> m_priorities;
+
+  cMutex m_lock;
+
+  // sessions of each pid (NULL: not received)
+  tRoute** volatile m_routes;
+
+  // route tables Receive() may still be using
+  cMutex m_retiredLock;
+
+  std::vector<tRoute**> m_retired;
+
+  volatile int m_hasRetired;
+
+  // pids in the receiver's pid list and whether they are open on the device.
+  // cReceiver can't remove single pids, closed ones stay in the list until
+  // the receiver is rebuilt.
+  std::map<int, bool> m_receiverPids;
+
+  // sessions using the hub (protected by m_hubsLock)
+  int m_refs;
+
+  static std::list<cLiveHub*> m_hubs;
+
+  static cMutex m_hubsLock;
+};
+
+#endif // XVDR_LIVEHUB_H
@@ -27,8 +27,7 @@
 #include "tools/hash.h"
 
 #include "livepatfilter.h"
-#include "livereceiver.h"
-#include "livestreamer.h"
+#include "livesession.h"
 
 static const char * const psStreamTypes[] = {
         "UNKNOWN",
@@ -54,18 +53,53 @@ static const char * const psStreamTypes[] = {
         "",
 };
 
-cLivePatFilter::cLivePatFilter(cLiveStreamer *Streamer, const cChannel *Channel)
+cLivePatFilter::cLivePatFilter()
 {
-  DEBUGLOG("cStreamdevPatFilter(\"%s\")", Channel->Name());
-  m_Channel     = Channel;
-  m_Streamer    = Streamer;
-  m_pmtPid      = 0;
-  m_pmtSid      = 0;
-  m_pmtVersion  = -1;
+  DEBUGLOG("cStreamdevPatFilter()");
   Set(0x00, 0x00);  // PAT
 
 }
 
+void cLivePatFilter::AddService(cLiveSession *Session, const cChannel *Channel)
+{
+  DEBUGLOG("cStreamdevPatFilter::AddService(\"%s\")", Channel->Name());
+
+  sService service;
+  service.session    = Session;
+  service.channel    = Channel;
+  service.pmtPid     = 0;
+  service.pmtSid     = 0;
+  service.pmtVersion = -1;
+
+  // the PMT pid is looked up with the next PAT
+  cMutexLock lock(&m_Mutex);
+  m_Services.push_back(service);
+}
+
+void cLivePatFilter::RemoveService(cLiveSession *Session)
+{
+  int pmtPid = 0;
+
+  m_Mutex.Lock();
+
+  for (std::list<sService>::iterator i = m_Services.begin(); i != m_Services.end(); i++)
+  {
+    if (i->session != Session)
+      continue;
+
+    pmtPid = i->pmtPid;
+    m_Services.erase(i);
+    break;
+  }
+
+  m_Mutex.Unlock();
+
+  // Del() takes the lock of the section handler, which calls Process() with
+  // that lock held. Section filters are reference counted by VDR.
+  if (pmtPid != 0)
+    cFilter::Del(pmtPid, 0x02);
+}
+
 void cLivePatFilter::GetLanguage(SI::PMT::Stream& stream, char *langs, int& type)
 {
   SI::Descriptor *d;
@@ -275,6 +309,8 @@ bool cLivePatFilter::GetStreamInfo(SI::PMT::Stream& stream, struct StreamInfo& i
 
 void cLivePatFilter::Process(u_short Pid, u_char Tid, const u_char *Data, int Length)
 {
+  cMutexLock lock(&m_Mutex);
+
   if (Pid == 0x00 && Tid == 0x00)
   {
     SI::PAT pat(Data, false);
@@ -287,70 +323,84 @@ void cLivePatFilter::Process(u_short Pid, u_char Tid, const u_char *Data, int Le
       if (!assoc.isNITPid())
       {
         const cChannel *Channel =  Channels.GetByServiceID(Source(), Transponder(), assoc.getServiceId());
-        if (Channel && (Channel == m_Channel))
+        if (Channel == NULL)
+          continue;
+
+        for (std::list<sService>::iterator i = m_Services.begin(); i != m_Services.end(); i++)
         {
-          int prevPmtPid = m_pmtPid;
-          if (0 != (m_pmtPid = assoc.getPid()))
+          if (Channel != i->channel)
+            continue;
+
+          int prevPmtPid = i->pmtPid;
+          if (0 != (i->pmtPid = assoc.getPid()))
           {
-            m_pmtSid = assoc.getServiceId();
-            if (m_pmtPid != prevPmtPid)
+            i->pmtSid = assoc.getServiceId();
+            if (i->pmtPid != prevPmtPid)
             {
-              Add(m_pmtPid, 0x02);
-              m_pmtVersion = -1;
+              Add(i->pmtPid, 0x02);
+              i->pmtVersion = -1;
             }
-            return;
           }
         }
       }
     }
   }
-  else if (Pid == m_pmtPid && Tid == SI::TableIdPMT && Source() && Transponder())
+  else if (Tid == SI::TableIdPMT && Source() && Transponder())
   {
     SI::PMT pmt(Data, false);
-    if (!pmt.CheckCRCAndParse() || pmt.getServiceId() != m_pmtSid)
+    if (!pmt.CheckCRCAndParse())
       return;
 
-    if (m_pmtVersion != -1)
+    for (std::list<sService>::iterator i = m_Services.begin(); i != m_Services.end(); i++)
     {
-      if (m_pmtVersion != pmt.getVersionNumber())
-      {
-        cFilter::Del(m_pmtPid, 0x02);
-        m_pmtPid = 0; // this triggers PAT scan
-      }
-      return;
+      if (Pid == i->pmtPid && pmt.getServiceId() == i->pmtSid)
+        ProcessPMT(*i, pmt);
     }
-    m_pmtVersion = pmt.getVersionNumber();
-
-    // get cached channel data
-    if(m_ChannelCache.size() == 0)
-      m_ChannelCache = cChannelCache::GetFromCache(CreateChannelUID(m_Channel));
+  }
+}
 
-    // get all streams and check if there are new (currently unknown) streams
-    SI::PMT::Stream stream;
-    cChannelCache cache;
-    for (SI::Loop::Iterator it; pmt.streamLoop.getNext(stream, it); )
+void cLivePatFilter::ProcessPMT(sService& service, SI::PMT& pmt)
+{
+  if (service.pmtVersion != -1)
+  {
+    if (service.pmtVersion != pmt.getVersionNumber())
     {
-      struct StreamInfo info;
-      if (GetStreamInfo(stream, info) && cache.size() < MAXRECEIVEPIDS)
-        cache.AddStream(info);
+      cFilter::Del(service.pmtPid, 0x02);
+      service.pmtPid = 0; // this triggers PAT scan
     }
+    return;
+  }
+  service.pmtVersion = pmt.getVersionNumber();
 
-    // no new streams found -> exit
-    if (cache == m_ChannelCache)
-      return;
+  // get cached channel data
+  if(service.cache.size() == 0)
+    service.cache = cChannelCache::GetFromCache(CreateChannelUID(service.channel));
 
-    m_Streamer->m_FilterMutex.Lock();
+  // get all streams and check if there are new (currently unknown) streams
+  SI::PMT::Stream stream;
+  cChannelCache cache;
+  for (SI::Loop::Iterator it; pmt.streamLoop.getNext(stream, it); )
+  {
+    struct StreamInfo info;
+    if (GetStreamInfo(stream, info) && cache.size() < MAXRECEIVEPIDS)
+      cache.AddStream(info);
+  }
 
-    // create new stream demuxers
-    cache.CreateDemuxers(m_Streamer);
+  // no new streams found -> exit
+  if (cache == service.cache)
+    return;
 
-    INFOLOG("Currently unknown new streams found, requesting stream change");
+  service.session->m_FilterMutex.Lock();
 
-    // write changed data back to the cache
-    m_ChannelCache = cache;
-    cChannelCache::AddToCache(CreateChannelUID(m_Channel), m_ChannelCache);
+  // create new stream demuxers
+  cache.CreateDemuxers(service.session);
 
-    m_Streamer->RequestStreamChange();
-    m_Streamer->m_FilterMutex.Unlock();
-  }
+  INFOLOG("Currently unknown new streams found, requesting stream change");
+
+  // write changed data back to the cache
+  service.cache = cache;
+  cChannelCache::AddToCache(CreateChannelUID(service.channel), service.cache);
+
+  service.session->RequestStreamChange();
+  service.session->m_FilterMutex.Unlock();
 }
@@ -26,31 +26,46 @@
 #ifndef XVDR_LIVEPATFILTER_H
 #define XVDR_LIVEPATFILTER_H
 
+#include <list>
 #include <vdr/filter.h>
+#include <vdr/thread.h>
 #include <libsi/section.h>
 #include <libsi/descriptor.h>
 
 #include "demuxer/demuxer.h"
 #include "channelcache.h"
 
-class cLiveStreamer;
+class cLiveSession;
+
+// PAT / PMT scanner of a transponder. Tracks the streams of all services
+// received through the same cLiveHub.
 
 class cLivePatFilter : public cFilter
 {
 private:
-  int             m_pmtPid;
-  int             m_pmtSid;
-  int             m_pmtVersion;
-  const cChannel *m_Channel;
-  cLiveStreamer  *m_Streamer;
-  cChannelCache   m_ChannelCache;
+  struct sService
+  {
+    cLiveSession   *session;
+    const cChannel *channel;
+    int             pmtPid;
+    int             pmtSid;
+    int             pmtVersion;
+    cChannelCache   cache;
+  };
+
+  std::list<sService> m_Services;
+  cMutex          m_Mutex;
 
   bool GetStreamInfo(SI::PMT::Stream& stream, struct StreamInfo& info);
   void GetLanguage(SI::PMT::Stream& stream, char *langs, int& type);
+  void ProcessPMT(sService& service, SI::PMT& pmt);
   virtual void Process(u_short Pid, u_char Tid, const u_char *Data, int Length);
 
 public:
-  cLivePatFilter(cLiveStreamer *Streamer, const cChannel *Channel);
+  cLivePatFilter();
+
+  void AddService(cLiveSession *Session, const cChannel *Channel);
+  void RemoveService(cLiveSession *Session);
 };
 
 #endif // XVDR_LIVEPATFILTER_H
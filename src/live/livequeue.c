@@ -23,169 +23,730 @@
  */
 
 #include <sys/types.h>
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
 #include <dirent.h>
 #include <unistd.h>
+#include <vector>
 
 #include "config/config.h"
+#include "demuxer/demuxer.h"
 #include "net/msgpacket.h"
+#include "net/os-config.h"
 #include "net/socketlock.h"
+#include "xvdr/xvdrcommand.h"
 #include "livequeue.h"
+#include "livesender.h"
+#include "timeshiftspace.h"
+#include "timeshiftstore.h"
 
 cString cLiveQueue::TimeShiftDir = "/video";
 uint64_t cLiveQueue::BufferSize = 1024*1024*1024;
 
-cLiveQueue::cLiveQueue(int sock) : m_socket(sock), m_readfd(-1), m_writefd(-1)
+// m_mark hasn't been set by the timeshift writer
+static const uint64_t NoMark = (uint64_t)-1;
+
+cLiveQueue::cLiveQueue(int sock, uint32_t channeluid) : m_socket(sock), m_channeluid(channeluid), m_sender(NULL), m_sendOffset(0), m_socketLocked(false), m_windowStart(0), m_store(NULL), m_reader(NULL), m_queue(QueueSize), m_queuedBytes(0), m_checksum(true), m_keyframe(0), m_keyframes(0), m_skipVideo(false), m_dropped(0), m_resyncs(0)
 {
   m_pause = false;
+  m_timeshift = false;
+  m_adding = 0;
+  m_windowWait = 0;
+  m_discard = 0;
+  m_discardPending = 0;
+  m_mark = NoMark;
+  m_markPending = 0;
+  m_queueStatus = false;
+  m_socketQueued = 0;
+  m_throughput = 0;
+  m_packets = 0;
+  m_writes = 0;
+  m_sent = 0;
+  m_lastSocketQueued = 0;
+  SetProfile(XVDR_STREAM_PROFILE_LOWLATENCY);
+
+  // keep the last seconds of the channel for instant rewind
+  if(cTimeShiftStore::GetMemoryWindow() > 0)
+    OpenTimeShift();
 }
 
 cLiveQueue::~cLiveQueue()
 {
   DEBUGLOG("Deleting LiveQueue");
-  m_cond.Signal();
-  Cancel(3);
+
+  // Process() isn't called anymore
+  if(m_sender != NULL)
+    m_sender->Detach(this);
+
+  // a packet may be written partly, finish it before the client writes again
+  cTimeMs timeout;
+
+  while(!m_sending.empty() && timeout.Elapsed() < 1000)
+  {
+    int rc = Flush();
+
+    if(rc == Blocked)
+      pollfd(m_socket, 100, false);
+    else if(rc > 0)
+      cCondWait::SleepMs(rc);
+  }
+
+  for(std::vector<MsgPacket*>::iterator i = m_sending.begin(); i != m_sending.end(); i++)
+    delete *i;
+
+  if(m_socketLocked)
+    cSocketLock::Unlock(m_socket);
+
+  double seconds = m_runtime.Elapsed() / 1000.0;
+
+  if(seconds > 0 && m_writes > 0)
+    INFOLOG("LiveQueue: %.1f packets/s, %.1f writes/s (%.1f packets per write)", m_packets / seconds, m_writes / seconds, (double)m_packets / m_writes);
+
+  if(m_dropped > 0 || m_resyncs > 0)
+    INFOLOG("LiveQueue: %llu packets dropped, %llu resyncs", (unsigned long long)m_dropped, (unsigned long long)m_resyncs);
+
+  INFOLOG("LiveQueue stopped");
+
   Cleanup();
   CloseTimeShift();
 }
 
+void cLiveQueue::Start()
+{
+  INFOLOG("LiveQueue started");
+  m_runtime.Set(0);
+  m_sender = cLiveSender::Attach(this);
+}
+
 void cLiveQueue::Cleanup()
 {
-  cMutexLock lock(&m_lock);
-  while(!empty())
+  MsgPacket* p;
+  while((p = Pop()) != NULL)
+    delete p;
+}
+
+bool cLiveQueue::Push(MsgPacket* p, const sStreamPacket* pkt)
+{
+  sQueueItem item;
+  item.packet = p;
+  item.queued = cTimeMs::Now();
+  item.pts = (pkt != NULL) ? pkt->pts : DVD_NOPTS_VALUE;
+  item.content = (pkt != NULL) ? pkt->content : scNONE;
+  item.frametype = (pkt != NULL) ? pkt->frametype : 0;
+
+  // account the packet before the sender can see (and delete) it
+  uint32_t length = p->getPacketLength();
+  uint32_t position = m_queue.Tail();
+  __sync_add_and_fetch(&m_queuedBytes, length);
+
+  if(!m_queue.Push(item))
   {
-    delete front();
-    pop();
+    __sync_sub_and_fetch(&m_queuedBytes, length);
+    return false;
   }
+
+  // remember the newest keyframe for resyncs
+  if(item.content == scVIDEO && item.frametype == PKT_I_FRAME)
+  {
+    m_keyframe = position;
+    __sync_synchronize();
+    m_keyframes++;
+  }
+
+  // end the batch window early if the batch is full
+  if((m_queuedBytes >= m_batchBytes || m_queue.Size() >= MaxBatch) && __sync_bool_compare_and_swap(&m_windowWait, 1, 0))
+    m_queue.Wakeup();
+
+  return true;
 }
 
-void cLiveQueue::Request()
+MsgPacket* cLiveQueue::Pop(sQueueItem* item)
 {
-  cMutexLock lock(&m_lock);
+  sQueueItem i;
 
-  // read packet from storage
-  MsgPacket* p = MsgPacket::read(m_readfd, 1000);
+  if(!m_queue.Pop(i))
+    return NULL;
 
-  // check for buffer overrun
-  if(p == NULL)
+  __sync_sub_and_fetch(&m_queuedBytes, i.packet->getPacketLength());
+
+  if(item != NULL)
+    *item = i;
+
+  return i.packet;
+}
+
+bool cLiveQueue::Drop(MsgPacket* p, const sStreamPacket* pkt)
+{
+  // control packets are never dropped
+  if(pkt == NULL)
+    return false;
+
+  // the kernel queue is filled up first if the client can't keep up
+  uint32_t bytes = m_queuedBytes + m_socketQueued + p->getPacketLength();
+
+  if(pkt->content == scVIDEO)
   {
-    // ring-buffer overrun ?
-    off_t pos = lseek(m_readfd, 0, SEEK_CUR);
-    if(pos < (off_t)BufferSize)
-      return;
+    // a new GOP may start if its keyframe fits
+    if(pkt->frametype == PKT_I_FRAME)
+      m_skipVideo = (bytes > MaxQueueBytes);
 
-    lseek(m_readfd, 0, SEEK_SET);
-    p = MsgPacket::read(m_readfd, 1000);
+    // drop the rest of the GOP, the following frames refer to the dropped one
+    else if(bytes > MaxQueueBytes)
+      m_skipVideo = true;
+
+    return m_skipVideo;
   }
 
-  // no packet
-  if(p == NULL)
+  // audio (and subtitles) are dropped last
+  return (bytes > MaxQueueBytes + AudioReserveBytes);
+}
+
+void cLiveQueue::Resync()
+{
+  sQueueItem front;
+
+  // the timeshift reader is driven by the client
+  if(m_timeshift || m_keyframes == 0 || !m_queue.Front(front))
     return;
 
-  // put packet into queue
-  push(p);
+  // the packets in the socket queue are late too
+  uint64_t latency = cTimeMs::Now() - front.queued + SocketDelay();
 
-  m_cond.Signal();
-}
+  if(latency <= (uint64_t)m_maxLatency)
+    return;
 
-bool cLiveQueue::Add(MsgPacket* p)
-{
-  cMutexLock lock(&m_lock);
+  // the newest keyframe must still be queued (and not be the oldest packet)
+  uint32_t keyframe = m_keyframe;
+
+  if((int32_t)(keyframe - m_queue.Head()) <= 0)
+    return;
 
-  // in timeshift mode ?
-  if(m_pause || (!m_pause && m_writefd != -1))
+  std::vector<MsgPacket*> packets;
+  std::vector<sQueueItem> audio;
+  uint32_t dropped = 0;
+
+  // skip everything in front of the keyframe, except control packets
+  while(m_queue.Head() != keyframe)
   {
-    // write packet
-    if(!p->write(m_writefd, 1000))
+    sQueueItem item;
+    Pop(&item);
+
+    if(item.content == scNONE)
+      packets.push_back(item.packet);
+    else if(item.content == scVIDEO)
     {
-      ERRORLOG("Unable to write packet into timeshift ringbuffer !");
-      delete p;
-      return false;
+      delete item.packet;
+      dropped++;
     }
+    else
+      audio.push_back(item);
+  }
+
+  sQueueItem key;
+  m_queue.Front(key);
 
-    // ring-buffer overrun ?
-    off_t length = lseek(m_writefd, 0, SEEK_CUR);
-    if(length >= (off_t)BufferSize)
+  // keep the audio playing along with the keyframe
+  for(std::vector<sQueueItem>::iterator i = audio.begin(); i != audio.end(); i++)
+  {
+    if(key.pts != DVD_NOPTS_VALUE && i->pts != DVD_NOPTS_VALUE && i->pts >= key.pts)
+      packets.push_back(i->packet);
+    else
     {
-      // truncate to current position
-      if(ftruncate(m_writefd, length) == 0)
-        lseek(m_writefd, 0, SEEK_SET);
+      delete i->packet;
+      dropped++;
     }
+  }
+
+  // tell the client
+  MsgPacket* resync = new MsgPacket(XVDR_STREAM_RESYNC, XVDR_CHANNEL_STREAM);
+  resync->put_S64(key.pts);
+  resync->put_U32(dropped);
+
+  m_sending.push_back(resync);
+  m_sending.insert(m_sending.end(), packets.begin(), packets.end());
+
+  m_resyncs++;
+  INFOLOG("LiveQueue: client is %llu ms behind, skipped %u packets to the newest keyframe", (unsigned long long)latency, dropped);
+}
+
+void cLiveQueue::Restart(const sTimeShiftPosition& pos)
+{
+  // packets read before the seek are outdated
+  m_discard = m_queue.Tail();
+  __sync_synchronize();
+  m_discardPending = 1;
+
+  // tell the client where the stream continues
+  MsgPacket* resync = new MsgPacket(XVDR_STREAM_RESYNC, XVDR_CHANNEL_STREAM);
+  resync->put_S64(pos.pts);
+  resync->put_U32(0);
+
+  if(!Push(resync))
+    delete resync;
+}
+
+void cLiveQueue::Discard()
+{
+  if(!__sync_bool_compare_and_swap(&m_discardPending, 1, 0))
+    return;
+
+  uint32_t discard = m_discard;
+
+  while((int32_t)(discard - m_queue.Head()) > 0)
+  {
+    MsgPacket* p = Pop();
+
+    if(p == NULL)
+      break;
+
     delete p;
-    return true;
   }
+}
+
+int cLiveQueue::Flush()
+{
+  // the client thread is writing a response
+  if(!m_socketLocked)
+  {
+    if(!cSocketLock::TryLock(m_socket))
+      return LockRetry;
+
+    m_socketLocked = true;
+
+    // the client doesn't check header checksums
+    if(!m_checksum)
+    {
+      for(std::vector<MsgPacket*>::iterator i = m_sending.begin(); i != m_sending.end(); i++)
+        (*i)->disableCheckSum();
+    }
+  }
+
+  int rc = MsgPacket::send(m_socket, &m_sending[0], m_sending.size(), m_sendOffset);
+
+  // keep the socket locked until the packets are complete
+  if(rc == SEWOULDBLOCK)
+    return Blocked;
+
+  // the client is gone, the packets are lost
+  if(rc != 0)
+    DEBUGLOG("LiveQueue: unable to send %u packets (%s)", (uint32_t)m_sending.size(), strerror(rc));
+
+  for(std::vector<MsgPacket*>::iterator i = m_sending.begin(); i != m_sending.end(); i++)
+    delete *i;
+
+  m_sending.clear();
+  m_sendOffset = 0;
+
+  m_socketLocked = false;
+  cSocketLock::Unlock(m_socket);
+
+  return 0;
+}
+
+bool cLiveQueue::BatchFull()
+{
+  return (m_queuedBytes >= m_batchBytes || m_queue.Size() >= MaxBatch);
+}
+
+uint32_t cLiveQueue::SocketQueued()
+{
+  int queued = 0;
+
+  if(ioctl(m_socket, SIOCOUTQ, &queued) == -1 || queued < 0)
+    return 0;
+
+  return queued;
+}
+
+uint32_t cLiveQueue::SocketDelay()
+{
+  uint32_t throughput = m_throughput;
+
+  if(throughput == 0)
+    return 0;
+
+  return (uint64_t)m_socketQueued * 1000 / throughput;
+}
+
+void cLiveQueue::SendQueueStatus()
+{
+  sQueueItem front;
+  uint32_t delay = 0;
+
+  // age of the oldest queued packet
+  if(m_queue.Front(front))
+    delay = cTimeMs::Now() - front.queued;
+
+  MsgPacket* p = new MsgPacket(XVDR_STREAM_QUEUESTATUS, XVDR_CHANNEL_STREAM);
+  p->put_U32(m_throughput);
+  p->put_U32(m_queue.Size());
+  p->put_U32(m_queuedBytes);
+  p->put_U32(delay);
+  p->put_U32(m_socketQueued);
+  p->put_U32(SocketDelay());
+  p->put_U32(m_dropped);
+  p->put_U32(m_resyncs);
+
+  m_sending.push_back(p);
+}
+
+void cLiveQueue::SetProfile(int profile)
+{
+  cMutexLock lock(&m_lock);
+
+  // throughput: collect packets for some time and send them in big chunks
+  if(profile == XVDR_STREAM_PROFILE_THROUGHPUT)
+  {
+    m_window = 50;
+    m_batchBytes = 256 * 1024;
+    m_maxLatency = 5000;
+  }
+  // low latency: send everything queued right away
+  else
+  {
+    m_window = 0;
+    m_batchBytes = 64 * 1024;
+    m_maxLatency = 2000;
+  }
+
+  DEBUGLOG("Stream profile %i: window %i ms, batch size %u bytes, max. latency %i ms", profile, m_window, m_batchBytes, m_maxLatency);
+}
+
+void cLiveQueue::DisableCheckSum()
+{
+  cMutexLock lock(&m_lock);
+  m_checksum = false;
+}
+
+void cLiveQueue::EnableQueueStatus()
+{
+  m_queueStatus = true;
+}
+
+void cLiveQueue::Request()
+{
+  cMutexLock lock(&m_lock);
+
+  if(m_reader == NULL)
+    return;
+
+  // read packet from storage (overruns are handled by the reader)
+  MsgPacket* p = m_reader->Read();
 
-  // queue too long ?
-  if (size() > 100) {
+  // no packet
+  if(p == NULL)
+    return;
+
+  // put packet into queue (we are the only producer in timeshift mode)
+  if(!Push(p))
+  {
+    ERRORLOG("Queue full, dropping timeshift packet !");
     delete p;
+  }
+}
+
+bool cLiveQueue::Seek(int64_t time, bool relative, sTimeShiftPosition& pos)
+{
+  cMutexLock lock(&m_lock);
+
+  // seeking in the live stream starts timeshifting
+  if(!StartTimeShift())
     return false;
+
+  if(relative)
+  {
+    sTimeShiftPosition current;
+
+    if(!m_store->FindPosition(m_reader->Position(), current))
+      return false;
+
+    time += current.time;
   }
 
-  // add packet to queue
-  push(p);
-  m_cond.Signal();
+  if(!m_store->FindTime(time < 0 ? 0 : time, pos))
+    return false;
+
+  m_reader->Seek(pos.position);
+  Restart(pos);
 
   return true;
 }
 
-void cLiveQueue::Action()
+bool cLiveQueue::NextKeyFrame(bool forward, sTimeShiftPosition& pos)
 {
-  INFOLOG("LiveQueue started");
+  cMutexLock lock(&m_lock);
 
-  // wait for first packet
-  m_cond.Wait(0);
+  if(!StartTimeShift())
+    return false;
 
-  while(Running())
-  {
-    MsgPacket* p = NULL;
+  // search from the last packet sent (it may have been a keyframe)
+  uint64_t position = forward ? m_reader->Position() : m_reader->PacketPosition();
 
-    m_lock.Lock();
+  if(!m_store->FindKeyFrame(position, forward, pos))
+    return false;
+
+  m_reader->Seek(pos.position);
+  Restart(pos);
+
+  MsgPacket* p = m_reader->Read();
+
+  if(p != NULL && !Push(p))
+    delete p;
+
+  return true;
+}
+
+bool cLiveQueue::GetTimeShiftRange(sTimeShiftPosition& first, sTimeShiftPosition& last, sTimeShiftPosition& current)
+{
+  cMutexLock lock(&m_lock);
+
+  if(m_store == NULL || !m_store->GetRange(first, last))
+    return false;
 
-    // just wait if we are paused
-    if(m_pause)
+  // not timeshifting: the client plays the newest packets
+  if(m_reader == NULL)
+    current = last;
+  else if(!m_store->FindPosition(m_reader->Position(), current))
+    current = first;
+
+  return true;
+}
+
+bool cLiveQueue::Add(MsgPacket* p, const sStreamPacket* pkt)
+{
+  // live packets are queued without taking a lock
+  __sync_add_and_fetch(&m_adding, 1);
+
+  if(!m_timeshift)
+  {
+    cTimeShiftStore* store = m_store;
+
+    // keep a copy in the memory window (before the sender owns the packet)
+    if(store != NULL && store->IsFeeder(this))
     {
-      m_lock.Unlock();
-      m_cond.Wait(0);
-      m_lock.Lock();
+      MsgPacket* copy = p->clone();
+
+      if(copy != NULL)
+        store->Append(copy, pkt, this);
     }
 
-    // check packet queue
-    if(size() > 0)
+    bool dropped = Drop(p, pkt);
+    bool rc = !dropped && Push(p, pkt);
+    __sync_sub_and_fetch(&m_adding, 1);
+
+    // queue too long ?
+    if(!rc)
     {
-      p = front();
-      pop();
+      // the ring is full, the following frames of the GOP would refer to a lost one
+      if(!dropped && pkt != NULL && pkt->content == scVIDEO)
+        m_skipVideo = true;
+
+      m_dropped++;
+      delete p;
     }
 
-    m_lock.Unlock();
+    return rc;
+  }
+
+  // hand the packet over to the writer thread (never blocks on the disk)
+  cTimeShiftStore* store = m_store;
+  bool rc = false;
 
-    // no packets to send
-    if(p == NULL)
+  // StartTimeShift() needs the position of the first timeshift packet
+  if(store != NULL && m_markPending && __sync_bool_compare_and_swap(&m_markPending, 1, 0))
+  {
+    if(!store->Mark(&m_mark, pkt))
+      m_mark = store->Head();
+  }
+
+  if(store != NULL)
+    rc = store->Append(p, pkt, this);
+  else
+    delete p;
+
+  __sync_sub_and_fetch(&m_adding, 1);
+  return rc;
+}
+
+int cLiveQueue::Process()
+{
+  // the streamer only signals while we are idle
+  m_queue.Unpark();
+  m_queue.Acknowledge();
+
+  // the socket didn't take the last batch completely
+  if(!m_sending.empty())
+  {
+    int rc = Flush();
+
+    if(rc != 0)
+      return rc;
+  }
+
+  // the client requests the packets (or doesn't want any)
+  if(m_pause)
+    return Idle;
+
+  uint64_t now = cTimeMs::Now();
+
+  // give the streamer some time to fill the batch
+  if(!m_queue.Empty() && m_window > 0)
+  {
+    if(m_windowStart == 0)
+      m_windowStart = now;
+
+    int remaining = m_window - (int)(now - m_windowStart);
+
+    if(remaining > 0 && !BatchFull())
     {
-      m_cond.Wait(3000);
-      continue;
-    }
-    // send packet
-    else {
-      cSocketLock locks(m_socket);
-      p->write(m_socket, 100);
-      delete p;
+      // the streamer wakes us up if the batch gets full
+      m_windowWait = 1;
+      __sync_synchronize();
+
+      if(!BatchFull())
+        return remaining;
     }
 
+    m_windowWait = 0;
   }
 
-  INFOLOG("LiveQueue stopped");
+  m_windowStart = 0;
+
+  // drop the packets in front of a seek
+  Discard();
+
+  // skip to the newest keyframe if the client has fallen behind
+  Resync();
+
+  // report the queue state along with the packets
+  if(m_status.Elapsed() >= StatusInterval)
+  {
+    m_socketQueued = SocketQueued();
+
+    // the client received what left the socket queue
+    int64_t received = (int64_t)m_sent - ((int64_t)m_socketQueued - m_lastSocketQueued);
+
+    m_throughput = (received > 0) ? received * 1000 / m_status.Elapsed() : 0;
+    m_lastSocketQueued = m_socketQueued;
+    m_sent = 0;
+    m_status.Set(0);
+
+    if(m_queueStatus)
+      SendQueueStatus();
+  }
+
+  // take all queued packets (within the batch limits)
+  uint32_t bytes = 0;
+  MsgPacket* p = NULL;
+
+  while(m_sending.size() < MaxBatch && bytes < m_batchBytes && (p = Pop()) != NULL)
+  {
+    bytes += p->getPacketLength();
+    m_sending.push_back(p);
+  }
+
+  // nothing to send, sleep until the streamer queues a packet
+  if(m_sending.empty())
+    return m_queue.Park() ? Idle : 0;
+
+  m_packets += m_sending.size();
+  m_writes++;
+  m_sent += bytes;
+
+  if(m_stats.Elapsed() >= 10000)
+  {
+    DEBUGLOG("LiveQueue: %.1f packets/s, %.1f writes/s, %u bytes/s, %u bytes in socket queue", m_packets * 1000.0 / m_runtime.Elapsed(), m_writes * 1000.0 / m_runtime.Elapsed(), m_throughput, m_socketQueued);
+    m_stats.Set(0);
+  }
+
+  int rc = Flush();
+
+  if(rc == 0)
+    m_socketQueued = SocketQueued();
+
+  return rc;
 }
 
 void cLiveQueue::CloseTimeShift()
 {
-  close(m_readfd);
-  m_readfd = -1;
-  close(m_writefd);
-  m_writefd = -1;
+  cTimeShiftStore* store = m_store;
+
+  // wait until Add() doesn't use the store anymore
+  m_store = NULL;
+  __sync_synchronize();
+
+  while(m_adding > 0)
+    cCondWait::SleepMs(1);
+
+  delete m_reader;
+  m_reader = NULL;
+
+  // the last client removes the file
+  cTimeShiftStore::Release(store, this);
+}
+
+bool cLiveQueue::OpenTimeShift()
+{
+  if(m_store != NULL)
+    return true;
+
+  m_storage = cString::sprintf("%s/xvdr-ringbuffer-%08x.data", (const char*)TimeShiftDir, m_channeluid);
+  DEBUGLOG("FILE: %s", (const char*)m_storage);
+
+  m_store = cTimeShiftStore::Acquire(m_channeluid, m_storage, BufferSize);
+
+  if(m_store == NULL)
+  {
+    ERRORLOG("Failed to create timeshift ringbuffer !");
+    return false;
+  }
+
+  // without memory window the buffer goes to the disk right away
+  if(cTimeShiftStore::GetMemoryWindow() == 0)
+    m_store->Spill();
+
+  return true;
+}
+
+bool cLiveQueue::StartTimeShift()
+{
+  if(m_reader != NULL)
+    return true;
+
+  if(!OpenTimeShift())
+    return false;
+
+  // from now on live packets go to the storage. wait until a packet that
+  // is just being added has been queued, Request() becomes the only producer.
+  m_timeshift = true;
+  __sync_synchronize();
+
+  while(m_adding > 0)
+    cCondWait::SleepMs(1);
+
+  // the next packet of the streamer is the first one to read from the storage
+  m_mark = NoMark;
+  __sync_synchronize();
+  m_markPending = 1;
+
+  cTimeMs timeout;
 
-  unlink(m_storage);
+  while(m_mark == NoMark && timeout.Elapsed() < 500)
+    cCondWait::SleepMs(1);
+
+  // no packets (signal lost ?)
+  if(__sync_bool_compare_and_swap(&m_markPending, 1, 0) || m_mark == NoMark)
+    m_mark = m_store->Head();
+
+  m_reader = new cTimeShiftReader(m_store, m_mark);
+
+  // queued packets are older than the storage, they will be sent first
+  DEBUGLOG("%u packets left in queue", m_queue.Size());
+
+  return true;
 }
 
-bool cLiveQueue::Pause(bool on)
+bool cLiveQueue::Pause(bool on, bool spill)
 {
   cMutexLock lock(&m_lock);
 
@@ -193,43 +754,21 @@ bool cLiveQueue::Pause(bool on)
   if(!on)
   {
     m_pause = false;
-    m_cond.Signal();
+    m_queue.Wakeup();
     return true;
   }
 
   if(m_pause)
     return false;
 
-  // create offline storage
-  if(m_readfd == -1)
-  {
-    m_storage = cString::sprintf("%s/xvdr-ringbuffer-%05i.data", (const char*)TimeShiftDir, m_socket);
-    DEBUGLOG("FILE: %s", (const char*)m_storage);
-
-    m_readfd = open(m_storage, O_CREAT | O_RDONLY, 0644);
-    m_writefd = open(m_storage, O_CREAT | O_WRONLY, 0644);
-    lseek(m_readfd, 0, SEEK_SET);
-    lseek(m_writefd, 0, SEEK_SET);
-
-    if(m_readfd == -1) {
-      ERRORLOG("Failed to create timeshift ringbuffer !");
-    }
-  }
-
   m_pause = true;
 
-  // push all packets from the queue to the offline storage
-  DEBUGLOG("Writing %i packets into timeshift buffer", size());
-
-  while(!empty())
-  {
-    MsgPacket* p = front();
-
-    p->write(m_writefd, 1000);
-    delete p;
+  if(!StartTimeShift())
+    return true;
 
-    pop();
-  }
+  // the client wants to keep the buffer on disk
+  if(spill)
+    m_store->Spill();
 
   return true;
 }
@@ -237,6 +776,7 @@ bool cLiveQueue::Pause(bool on)
 void cLiveQueue::SetTimeShiftDir(const cString& dir)
 {
   TimeShiftDir = dir;
+  cTimeShiftSpace::SetDirectory(dir);
   DEBUGLOG("TIMESHIFTDIR: %s", (const char*)TimeShiftDir);
 }
 
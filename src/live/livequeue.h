@@ -25,24 +25,62 @@
 #ifndef XVDR_LIVEQUEUE_H
 #define XVDR_LIVEQUEUE_H
 
-#include <queue>
+#include <vector>
 #include <vdr/thread.h>
+#include "tools/spscqueue.h"
 
 class MsgPacket;
+class cLiveSender;
+class cTimeShiftStore;
+class cTimeShiftReader;
+struct sStreamPacket;
+struct sTimeShiftPosition;
 
-class cLiveQueue : public cThread, protected std::queue<MsgPacket*>
+// Packets of a live stream on their way to the client. The streamer (or
+// the timeshift reader) queues them, a shared cLiveSender thread writes
+// them into the socket (see Process()).
+
+class cLiveQueue
 {
 public:
 
-  cLiveQueue(int s);
+  cLiveQueue(int s, uint32_t channeluid);
 
   virtual ~cLiveQueue();
 
-  bool Add(MsgPacket* p);
+  // start sending
+  void Start();
+
+  // sender thread: send what's possible without blocking, returns the ms
+  // until the next run, Idle (wait for packets) or Blocked (wait for the socket)
+  int Process();
+
+  int Socket() const { return m_socket; }
+
+  // readable when the sender needs to run the queue
+  int EventFd() const { return m_queue.Fd(); }
+
+  bool Add(MsgPacket* p, const sStreamPacket* pkt = NULL);
 
   void Request();
 
-  bool Pause(bool on = true);
+  // spill: write the memory window to disk
+  bool Pause(bool on = true, bool spill = false);
+
+  // move the timeshift read cursor (time in ms)
+  bool Seek(int64_t time, bool relative, sTimeShiftPosition& pos);
+
+  // send the next (or previous) keyframe only (trick play)
+  bool NextKeyFrame(bool forward, sTimeShiftPosition& pos);
+
+  bool GetTimeShiftRange(sTimeShiftPosition& first, sTimeShiftPosition& last, sTimeShiftPosition& current);
+
+  void SetProfile(int profile);
+
+  void DisableCheckSum();
+
+  // send XVDR_STREAM_QUEUESTATUS reports to the client
+  void EnableQueueStatus();
 
   static void SetTimeShiftDir(const cString& dir);
 
@@ -50,28 +88,162 @@ public:
 
   static void RemoveTimeShiftFiles();
 
-protected:
+  enum
+  {
+    Idle = -1,
+    Blocked = -2
+  };
 
-  void Action();
+protected:
 
   void Cleanup();
 
+  bool OpenTimeShift();
+
+  bool StartTimeShift();
+
   void CloseTimeShift();
 
+  struct sQueueItem
+  {
+    MsgPacket* packet;
+    uint64_t   queued;     // time of Add() (ms)
+    int64_t    pts;
+    uint8_t    content;    // eStreamContent (scNONE for control packets)
+    uint8_t    frametype;  // PKT_I_FRAME, ...
+  };
+
+  bool Push(MsgPacket* p, const sStreamPacket* pkt = NULL);
+
+  MsgPacket* Pop(sQueueItem* item = NULL);
+
+  bool Drop(MsgPacket* p, const sStreamPacket* pkt);
+
+  void Resync();
+
+  void Restart(const sTimeShiftPosition& pos);
+
+  void Discard();
+
+  // write the pending packets, returns 0 when done, Blocked or the ms to retry
+  int Flush();
+
+  bool BatchFull();
+
+  // bytes waiting in the kernel send queue (SIOCOUTQ)
+  uint32_t SocketQueued();
+
+  // time the kernel needs to send its queue (ms)
+  uint32_t SocketDelay();
+
+  void SendQueueStatus();
+
   int m_socket;
 
-  int m_readfd;
+  uint32_t m_channeluid;
+
+  cLiveSender* m_sender;
+
+  // packets being written (the socket lock is held until all are written)
+  std::vector<MsgPacket*> m_sending;
+
+  uint32_t m_sendOffset;
+
+  bool m_socketLocked;
 
-  int m_writefd;
+  // start of the batch window (0: not waiting)
+  uint64_t m_windowStart;
 
-  bool m_pause;
+  // shared with other clients on the same channel
+  cTimeShiftStore* volatile m_store;
 
+  cTimeShiftReader* m_reader;
+
+  volatile bool m_pause;
+
+  // packets go to the timeshift storage (set once, never reset)
+  volatile bool m_timeshift;
+
+  // Add() is about to queue a live packet
+  volatile int m_adding;
+
+  // sender waits in the batch window
+  volatile int m_windowWait;
+
+  // timeshift storage and settings
   cMutex m_lock;
 
-  cCondWait m_cond;
+  // demuxer (or timeshift reader) -> sender
+  cSPSCQueue<sQueueItem> m_queue;
 
   cString m_storage;
 
+  volatile uint32_t m_queuedBytes;
+
+  int m_window;
+
+  uint32_t m_batchBytes;
+
+  bool m_checksum;
+
+  // queue position of the newest keyframe (valid if m_keyframes > 0)
+  volatile uint32_t m_keyframe;
+
+  volatile uint32_t m_keyframes;
+
+  // video frames are dropped until the next keyframe
+  bool m_skipVideo;
+
+  // resync if the oldest packet waits longer than this (ms)
+  int m_maxLatency;
+
+  uint64_t m_dropped;
+
+  uint64_t m_resyncs;
+
+  // report the queue state to the client
+  volatile bool m_queueStatus;
+
+  // measured by the sender: bytes in the socket queue, bytes/s received by the client
+  volatile uint32_t m_socketQueued;
+
+  volatile uint32_t m_throughput;
+
+  // sender statistics
+  uint64_t m_packets;
+
+  uint64_t m_writes;
+
+  uint64_t m_sent;
+
+  uint32_t m_lastSocketQueued;
+
+  cTimeMs m_stats;
+
+  cTimeMs m_status;
+
+  cTimeMs m_runtime;
+
+  // the sender drops everything queued in front of this position (after a seek)
+  volatile uint32_t m_discard;
+
+  volatile int m_discardPending;
+
+  // position of the first timeshift packet (set by the timeshift writer)
+  volatile uint64_t m_mark;
+
+  volatile int m_markPending;
+
+  enum
+  {
+    MaxBatch = 64,
+    QueueSize = 1024,
+    MaxQueueBytes = 4 * 1024 * 1024,    // video is dropped above this
+    AudioReserveBytes = 512 * 1024,     // audio and subtitles can use some more
+    StatusInterval = 1000,              // ms between throughput measurements (and reports)
+    LockRetry = 10                      // ms until the next try if the socket is in use
+  };
+
   static cString TimeShiftDir;
 
   static uint64_t BufferSize;
@@ -25,11 +25,11 @@
 
 #include "config/config.h"
 #include "livereceiver.h"
-#include "livestreamer.h"
+#include "livehub.h"
 
-cLiveReceiver::cLiveReceiver(cLiveStreamer *Streamer, int Priority)
+cLiveReceiver::cLiveReceiver(cLiveHub *Hub, int Priority)
  : cReceiver(NULL, Priority)
- , m_Streamer(Streamer)
+ , m_Hub(Hub)
 {
   DEBUGLOG("Starting live receiver");
 }
@@ -41,15 +41,12 @@ cLiveReceiver::~cLiveReceiver()
 
 void cLiveReceiver::Receive(uchar *Data, int Length)
 {
-  int p = m_Streamer->Put(Data, Length);
-
-  if (p != Length)
-    m_Streamer->ReportOverflow(Length - p);
+  m_Hub->Receive(Data, Length);
 }
 
 inline void cLiveReceiver::Activate(bool On)
 {
-  m_Streamer->Activate(On);
+  m_Hub->Activate(On);
 }
 
 
@@ -28,21 +28,21 @@
 
 #include <vdr/receiver.h>
 
-class cLiveStreamer;
+class cLiveHub;
 
 class cLiveReceiver: public cReceiver
 {
-  friend class cLiveStreamer;
+  friend class cLiveHub;
 
 private:
-  cLiveStreamer *m_Streamer;
+  cLiveHub *m_Hub;
 
 protected:
   virtual void Activate(bool On);
   virtual void Receive(uchar *Data, int Length);
 
 public:
-  cLiveReceiver(cLiveStreamer *Streamer, int Priority);
+  cLiveReceiver(cLiveHub *Hub, int Priority);
   virtual ~cLiveReceiver();
 };
 
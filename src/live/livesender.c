@@ -0,0 +1,227 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "config/config.h"
+#include "livequeue.h"
+#include "livesender.h"
+
+int cLiveSender::Threads = 1;
+std::vector<cLiveSender*> cLiveSender::m_senders;
+cMutex cLiveSender::m_sendersLock;
+
+cLiveSender::cLiveSender() : cThread("XVDR Live Sender")
+{
+  m_epoll = epoll_create1(EPOLL_CLOEXEC);
+  m_wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.ptr = this;
+
+  if(m_epoll == -1 || m_wakeup == -1 || epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeup, &ev) == -1)
+    ERRORLOG("Unable to create the event loop of the live sender");
+}
+
+cLiveSender::~cLiveSender()
+{
+  Cancel(-1);
+  eventfd_write(m_wakeup, 1);
+  Cancel(3);
+
+  close(m_epoll);
+  close(m_wakeup);
+}
+
+void cLiveSender::SetThreads(int count)
+{
+  Threads = (count > 0) ? count : 1;
+  DEBUGLOG("Live sender threads: %i", Threads);
+}
+
+cLiveSender* cLiveSender::Attach(cLiveQueue* queue)
+{
+  cMutexLock lock(&m_sendersLock);
+
+  cLiveSender* sender = NULL;
+  size_t count = 0;
+
+  // the sender with the fewest queues
+  for(std::vector<cLiveSender*>::iterator i = m_senders.begin(); i != m_senders.end(); i++)
+  {
+    cMutexLock senderlock(&(*i)->m_lock);
+
+    if(sender == NULL || (*i)->m_queues.size() < count)
+    {
+      sender = *i;
+      count = sender->m_queues.size();
+    }
+  }
+
+  // start another thread if all are busy
+  if(sender == NULL || (count > 0 && (int)m_senders.size() < Threads))
+  {
+    sender = new cLiveSender;
+    sender->Start();
+    m_senders.push_back(sender);
+
+    INFOLOG("Started live sender thread %i", (int)m_senders.size());
+  }
+
+  sender->Add(queue);
+  return sender;
+}
+
+void cLiveSender::Shutdown()
+{
+  cMutexLock lock(&m_sendersLock);
+
+  for(std::vector<cLiveSender*>::iterator i = m_senders.begin(); i != m_senders.end(); i++)
+    delete *i;
+
+  m_senders.clear();
+}
+
+void cLiveSender::Add(cLiveQueue* queue)
+{
+  cMutexLock lock(&m_lock);
+
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.ptr = queue;
+
+  if(epoll_ctl(m_epoll, EPOLL_CTL_ADD, queue->EventFd(), &ev) == -1)
+    ERRORLOG("Unable to add live queue to the sender (%s)", strerror(errno));
+
+  // process it right away
+  sConnection c;
+  c.deadline = cTimeMs::Now();
+  c.writable = false;
+
+  m_queues[queue] = c;
+  eventfd_write(m_wakeup, 1);
+}
+
+void cLiveSender::Detach(cLiveQueue* queue)
+{
+  // waits for the queue being processed
+  cMutexLock lock(&m_lock);
+
+  std::map<cLiveQueue*, sConnection>::iterator i = m_queues.find(queue);
+
+  if(i == m_queues.end())
+    return;
+
+  epoll_ctl(m_epoll, EPOLL_CTL_DEL, queue->EventFd(), NULL);
+
+  if(i->second.writable)
+    epoll_ctl(m_epoll, EPOLL_CTL_DEL, queue->Socket(), NULL);
+
+  m_queues.erase(i);
+}
+
+int cLiveSender::NextTimeout(uint64_t now)
+{
+  int timeout = MaxTimeout;
+
+  for(std::map<cLiveQueue*, sConnection>::iterator i = m_queues.begin(); i != m_queues.end(); i++)
+  {
+    uint64_t deadline = i->second.deadline;
+
+    if(deadline == 0)
+      continue;
+
+    if(deadline <= now)
+      return 0;
+
+    if(deadline - now < (uint64_t)timeout)
+      timeout = deadline - now;
+  }
+
+  return timeout;
+}
+
+void cLiveSender::Run(cLiveQueue* queue, sConnection& connection, uint64_t now)
+{
+  int wait = queue->Process();
+
+  connection.deadline = (wait >= 0) ? now + wait : 0;
+
+  // wait for the socket (or stop waiting)
+  bool writable = (wait == cLiveQueue::Blocked);
+
+  if(writable == connection.writable)
+    return;
+
+  struct epoll_event ev;
+  ev.events = EPOLLOUT;
+  ev.data.ptr = queue;
+
+  epoll_ctl(m_epoll, writable ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, queue->Socket(), &ev);
+  connection.writable = writable;
+}
+
+void cLiveSender::Action()
+{
+  struct epoll_event events[MaxEvents];
+  int timeout = 0;
+
+  while(Running())
+  {
+    int count = epoll_wait(m_epoll, events, MaxEvents, timeout);
+
+    cMutexLock lock(&m_lock);
+    uint64_t now = cTimeMs::Now();
+
+    for(int n = 0; n < count; n++)
+    {
+      if(events[n].data.ptr == this)
+      {
+        eventfd_t value;
+        eventfd_read(m_wakeup, &value);
+        continue;
+      }
+
+      // the queue may have been detached in the meantime
+      std::map<cLiveQueue*, sConnection>::iterator i = m_queues.find((cLiveQueue*)events[n].data.ptr);
+
+      if(i != m_queues.end())
+        Run(i->first, i->second, now);
+    }
+
+    // timers
+    for(std::map<cLiveQueue*, sConnection>::iterator i = m_queues.begin(); i != m_queues.end(); i++)
+    {
+      if(i->second.deadline != 0 && i->second.deadline <= now)
+        Run(i->first, i->second, now);
+    }
+
+    timeout = NextTimeout(cTimeMs::Now());
+  }
+}
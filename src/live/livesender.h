@@ -0,0 +1,103 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef XVDR_LIVESENDER_H
+#define XVDR_LIVESENDER_H
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+#include <vdr/thread.h>
+
+class cLiveQueue;
+
+// Event loop writing the live queues of many clients into their sockets.
+// A few of these threads serve all live streams. A queue is processed when
+// it has been woken (new packets), its socket became writable again or its
+// timer (batch window) expired. Sockets are written without blocking, a slow
+// client just keeps its pending packets until the socket takes them.
+
+class cLiveSender : public cThread
+{
+public:
+
+  cLiveSender();
+
+  virtual ~cLiveSender();
+
+  // hand the queue to the least busy sender
+  static cLiveSender* Attach(cLiveQueue* queue);
+
+  // stop processing the queue (returns when it isn't processed anymore)
+  void Detach(cLiveQueue* queue);
+
+  // number of sender threads
+  static void SetThreads(int count);
+
+  // stop all sender threads
+  static void Shutdown();
+
+protected:
+
+  void Action();
+
+private:
+
+  struct sConnection
+  {
+    uint64_t deadline;     // run the queue at this time (0: not scheduled)
+    bool     writable;     // waiting for the socket
+  };
+
+  void Add(cLiveQueue* queue);
+
+  // process a queue and schedule the next run (m_lock held)
+  void Run(cLiveQueue* queue, sConnection& connection, uint64_t now);
+
+  // time until the next scheduled run (m_lock held)
+  int NextTimeout(uint64_t now);
+
+  int m_epoll;
+
+  // wakes the event loop
+  int m_wakeup;
+
+  cMutex m_lock;
+
+  std::map<cLiveQueue*, sConnection> m_queues;
+
+  static int Threads;
+
+  static std::vector<cLiveSender*> m_senders;
+
+  static cMutex m_sendersLock;
+
+  enum
+  {
+    MaxEvents = 64,
+    MaxTimeout = 1000    // ms, check Running() regularly
+  };
+};
+
+#endif // XVDR_LIVESENDER_H
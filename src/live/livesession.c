@@ -0,0 +1,865 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <vdr/i18n.h>
+#include <vdr/remux.h>
+#include <vdr/channels.h>
+#include <vdr/timers.h>
+
+#include "config/config.h"
+#include "net/msgpacket.h"
+#include "net/msgbuffer.h"
+#include "xvdr/xvdrcommand.h"
+#include "tools/hash.h"
+#include "demuxer/tsscan.h"
+#include "tools/spscring.h"
+
+#include "livesession.h"
+#include "livestreamer.h"
+#include "livehub.h"
+#include "channelcache.h"
+
+std::map<uint32_t, cLiveSession*> cLiveSession::m_sessions;
+
+std::map<uint32_t, uint32_t> cLiveSession::m_bitrates;
+
+cMutex cLiveSession::m_bitratesLock;
+
+cMutex cLiveSession::m_sessionsLock;
+
+cLiveSession::cLiveSession(const cChannel *channel, int priority, uint32_t timeout)
+ : cThread("cLiveSession stream processor")
+ , m_scanTimeout(timeout)
+{
+  m_Channel         = channel;
+  m_Priority        = priority;
+  m_Device          = NULL;
+  m_Hub             = NULL;
+  m_PidTable        = new cTSDemuxer*[PidTableSize];
+  m_Frontend        = -1;
+  m_startup         = true;
+  m_SignalLost      = false;
+  m_receiving       = false;
+  m_uid             = CreateChannelUID(channel);
+  m_refs            = 0;
+  m_bitrate         = 0;
+  m_overflows       = 0;
+  m_serial          = 0;
+
+  memset(&m_FrontendInfo, 0, sizeof(m_FrontendInfo));
+  memset(m_PidTable, 0, PidTableSize * sizeof(cTSDemuxer*));
+
+  if(m_scanTimeout == 0)
+    m_scanTimeout = XVDRServerConfig.stream_timeout;
+
+  // size the receive ring from the bitrate the channel had last time
+  uint32_t size = DefaultRingSize;
+
+  cMutexLock lock(&m_bitratesLock);
+  std::map<uint32_t, uint32_t>::iterator i = m_bitrates.find(m_uid);
+
+  if(i != m_bitrates.end())
+  {
+    m_bitrate = i->second;
+    size = std::max((uint32_t)MinRingSize, std::min((uint32_t)MaxRingSize, m_bitrate * RingTime));
+  }
+
+  m_Ring = new cSPSCRing(size, TS_SIZE);
+  m_Ring->SetDeadline(WakeupDelay);
+  UpdateThreshold();
+}
+
+cLiveSession::~cLiveSession()
+{
+  DEBUGLOG("Started to delete live session");
+
+  cTimeMs t;
+
+  // stop scanning and receiving before the demuxers go away
+  if (m_Hub)
+  {
+    m_Hub->Remove(this);
+    cLiveHub::Release(m_Hub);
+  }
+
+  // stop the demux thread before anything it uses is freed
+  Cancel(-1);
+  m_Ring->Wakeup();
+  Cancel(3);
+
+  if (m_Device)
+  {
+    for (std::list<cTSDemuxer*>::iterator i = m_Demuxers.begin(); i != m_Demuxers.end(); i++)
+    {
+      if ((*i) != NULL)
+      {
+        DEBUGLOG("Deleting stream demuxer for pid=%i and type=%i", (*i)->GetPID(), (*i)->Type());
+        delete (*i);
+      }
+    }
+    m_Demuxers.clear();
+
+  }
+  if (m_Frontend >= 0)
+  {
+    close(m_Frontend);
+    m_Frontend = -1;
+  }
+
+  delete[] m_PidTable;
+  delete m_Ring;
+
+  DEBUGLOG("Finished to delete live session (took %llu ms)", t.Elapsed());
+}
+
+cLiveSession* cLiveSession::Acquire(const cChannel *channel, int priority, uint32_t timeout, MsgPacket* resp)
+{
+  if (channel == NULL)
+  {
+    ERRORLOG("Starting streaming of channel without valid channel");
+    resp->put_U32(XVDR_RET_ERROR);
+    return NULL;
+  }
+
+  cMutexLock lock(&m_sessionsLock);
+
+  // channel already received for another client ?
+  std::map<uint32_t, cLiveSession*>::iterator i = m_sessions.find(CreateChannelUID(channel));
+
+  if(i != m_sessions.end())
+  {
+    cLiveSession* session = i->second;
+    session->m_refs++;
+
+    INFOLOG("--------------------------------------");
+    INFOLOG("Sharing live session of channel %i - %s (%i clients)", channel->Number(), channel->Name(), session->m_refs);
+    return session;
+  }
+
+  cLiveSession* session = new cLiveSession(channel, priority, timeout);
+
+  if(!session->Tune(resp))
+  {
+    delete session;
+    return NULL;
+  }
+
+  session->m_refs = 1;
+  m_sessions[session->m_uid] = session;
+
+  return session;
+}
+
+void cLiveSession::Release(cLiveSession* session)
+{
+  if(session == NULL)
+    return;
+
+  cMutexLock lock(&m_sessionsLock);
+
+  if(--session->m_refs > 0)
+  {
+    DEBUGLOG("Live session of channel %i - %s still used by %i clients", session->m_Channel->Number(), session->m_Channel->Name(), session->m_refs);
+    return;
+  }
+
+  m_sessions.erase(session->m_uid);
+  delete session;
+}
+
+bool cLiveSession::Tune(MsgPacket* resp)
+{
+  // check if any device is able to decrypt the channel - code taken from VDR
+  int NumUsableSlots = 0;
+
+  if (m_Channel->Ca() >= CA_ENCRYPTED_MIN) {
+    for (cCamSlot *CamSlot = CamSlots.First(); CamSlot; CamSlot = CamSlots.Next(CamSlot)) {
+      if (CamSlot->ModuleStatus() == msReady) {
+        if (CamSlot->ProvidesCa(m_Channel->Caids())) {
+          if (!ChannelCamRelations.CamChecked(m_Channel->GetChannelID(), CamSlot->SlotNumber())) {
+            NumUsableSlots++;
+          }
+       }
+      }
+    }
+    if (!NumUsableSlots) {
+      ERRORLOG("Unable to decrypt channel %i - %s", m_Channel->Number(), m_Channel->Name());
+      resp->put_U32(XVDR_RET_ENCRYPTED);
+      return false;
+    }
+  }
+
+  // get device for this channel
+  m_Device = cDevice::GetDevice(m_Channel, m_Priority, true);
+
+  // try a bit harder if we can't find a device
+  if(m_Device == NULL)
+    m_Device = cDevice::GetDevice(m_Channel, m_Priority, false);
+
+  INFOLOG("--------------------------------------");
+  INFOLOG("Channel streaming request: %i - %s", m_Channel->Number(), m_Channel->Name());
+
+  if (m_Device == NULL)
+  {
+    ERRORLOG("Can't get device for channel %i - %s", m_Channel->Number(), m_Channel->Name());
+
+    // return status "recording running" if there is an active timer
+    time_t now = time(NULL);
+    if(Timers.GetMatch(now) != NULL)
+      resp->put_U32(XVDR_RET_RECRUNNING);
+    else
+      resp->put_U32(XVDR_RET_DATALOCKED);
+
+    return false;
+  }
+
+  INFOLOG("Found available device %d", m_Device->DeviceNumber() + 1);
+
+  if (!m_Device->SwitchChannel(m_Channel, false))
+  {
+    ERRORLOG("Can't switch to channel %i - %s", m_Channel->Number(), m_Channel->Name());
+    resp->put_U32(XVDR_RET_ERROR);
+    return false;
+  }
+
+  return true;
+}
+
+void cLiveSession::Subscribe(cLiveStreamer* streamer)
+{
+  m_FilterMutex.Lock();
+  m_Subscribers.push_back(streamer);
+  UpdateSubscriberSettings();
+  int priority = m_Priority;
+  m_FilterMutex.Unlock();
+
+  // the first client starts receiving. The filter mutex must not be held
+  // here, the section handler calls the PAT filter with its own lock held.
+  cMutexLock lock(&m_sessionsLock);
+
+  // a client with a higher priority keeps the device as if it had tuned alone
+  if(m_receiving)
+  {
+    m_Hub->SetPriority(this, priority);
+    return;
+  }
+
+  // share the receiver with the other channels of the transponder
+  m_Hub = cLiveHub::Acquire(m_Device, m_Channel, this, m_Priority);
+
+  // get cached demuxer data
+  DEBUGLOG("Creating demuxers");
+  cChannelCache cache = cChannelCache::GetFromCache(m_uid);
+  if(cache.size() != 0) {
+    cache.CreateDemuxers(this);
+    RequestStreamChange();
+  }
+
+  m_Hub->AddService(this, m_Channel);
+  Start();
+
+  m_receiving = true;
+  INFOLOG("Successfully switched to channel %i - %s", m_Channel->Number(), m_Channel->Name());
+}
+
+void cLiveSession::Unsubscribe(cLiveStreamer* streamer)
+{
+  m_FilterMutex.Lock();
+  m_Subscribers.remove(streamer);
+  UpdateSubscriberSettings();
+  int priority = m_Priority;
+  m_FilterMutex.Unlock();
+
+  cMutexLock lock(&m_sessionsLock);
+
+  if(m_receiving)
+    m_Hub->SetPriority(this, priority);
+}
+
+void cLiveSession::UpdateSubscriberSettings()
+{
+  if(m_Subscribers.empty())
+    return;
+
+  int priority = m_Subscribers.front()->m_Priority;
+  uint32_t timeout = 0;
+
+  for (std::list<cLiveStreamer*>::iterator i = m_Subscribers.begin(); i != m_Subscribers.end(); i++)
+  {
+    uint32_t t = ((*i)->m_scanTimeout != 0) ? (*i)->m_scanTimeout : XVDRServerConfig.stream_timeout;
+
+    priority = std::max(priority, (*i)->m_Priority);
+    timeout = (timeout == 0) ? t : std::min(timeout, t);
+  }
+
+  if(priority != m_Priority)
+    INFOLOG("Priority of channel %i - %s changed from %i to %i", m_Channel->Number(), m_Channel->Name(), m_Priority, priority);
+
+  m_Priority = priority;
+  m_scanTimeout = timeout;
+}
+
+uint32_t cLiveSession::ScanTimeout()
+{
+  cMutexLock lock(&m_FilterMutex);
+  return m_scanTimeout;
+}
+
+void cLiveSession::RequestStreamChange()
+{
+  cMutexLock lock(&m_FilterMutex);
+
+  for (std::list<cLiveStreamer*>::iterator i = m_Subscribers.begin(); i != m_Subscribers.end(); i++)
+    (*i)->RequestStreamChange();
+}
+
+void cLiveSession::Broadcast(MsgPacket* packet, sStreamPacket* pkt)
+{
+  cMutexLock lock(&m_FilterMutex);
+
+  if(m_Subscribers.empty())
+  {
+    delete packet;
+    return;
+  }
+
+  std::list<cLiveStreamer*>::iterator i = m_Subscribers.begin();
+
+  while(i != m_Subscribers.end())
+  {
+    cLiveStreamer* streamer = *i++;
+
+    // the last subscriber gets the original, all others a clone sharing
+    // the attached frame buffer (the header is patched per client)
+    MsgPacket* p = (i == m_Subscribers.end()) ? packet : packet->clone();
+
+    if(p == NULL)
+    {
+      ERRORLOG("Unable to clone stream packet");
+      continue;
+    }
+
+    streamer->sendPacket(p, pkt);
+  }
+}
+
+void cLiveSession::Action(void)
+{
+  uint32_t size         = 0;
+  int used              = 0;
+  unsigned char *buf    = NULL;
+  m_startup             = true;
+
+  sTsHeader headers[ScanBatch];
+
+  cTimeMs last_info;
+  last_info.Set(0);
+
+  cTimeMs last_rate;
+  uint64_t received = 0;
+
+  while (Running())
+  {
+    // sleep until the receiver collected enough data (or the deadline passed)
+    m_Ring->Wait(IdleTimeout);
+
+    size = 0;
+    used = 0;
+    buf = m_Ring->Get(size);
+
+    if(last_rate.Elapsed() >= 1000)
+    {
+      UpdateBitrate(received, last_rate.Elapsed());
+      received = 0;
+      last_rate.Set(0);
+    }
+
+    if(!IsStarting() && !m_SignalLost && (m_last_tick.Elapsed() > (uint64_t)ScanTimeout() * 1000))
+    {
+      INFOLOG("timeout. signal lost!");
+      sendStatus(XVDR_STREAM_STATUS_SIGNALLOST);
+      m_SignalLost = true;
+    }
+
+    // no data
+    if (buf == NULL || size < TS_SIZE)
+      continue;
+
+    /* Make sure we are looking at a TS packet */
+    int skip = TsSync(buf, size);
+    buf  += skip;
+    size -= skip;
+    used += skip;
+
+    // lock the demuxers once for the whole chunk
+    m_FilterMutex.Lock();
+    cTSDemuxer **table = m_PidTable;
+
+    while (size >= TS_SIZE)
+    {
+      if(!Running())
+      {
+        break;
+      }
+
+      // classify a batch of headers, stops if the sync got lost
+      int count = std::min((int)size / TS_SIZE, (int)ScanBatch);
+      int valid = TsScanHeaders(buf, count, headers);
+
+      for (int i = 0; i < valid; i++)
+      {
+        cTSDemuxer *demuxer = table[headers[i].pid];
+        if (demuxer)
+        {
+          demuxer->ProcessTSPacket(buf + i * TS_SIZE, headers[i]);
+        }
+      }
+
+      buf  += valid * TS_SIZE;
+      size -= valid * TS_SIZE;
+      used += valid * TS_SIZE;
+
+      if (valid == count)
+        continue;
+
+      // resync
+      skip = 1 + TsSync(buf + 1, size - 1);
+      buf  += skip;
+      size -= skip;
+      used += skip;
+    }
+
+    m_FilterMutex.Unlock();
+    m_Ring->Del(used);
+    received += used;
+
+    if(last_info.Elapsed() >= 10*1000 && IsReady())
+    {
+      last_info.Set(0);
+      sendStreamInfo();
+      sendSignalInfo();
+    }
+  }
+}
+
+int cLiveSession::Put(const uchar *Data, int Length)
+{
+  // overflows are counted by the ring
+  if(!m_Ring->Put(Data, Length))
+    return 0;
+
+  return Length;
+}
+
+void cLiveSession::UpdateBitrate(uint64_t bytes, uint64_t elapsed)
+{
+  if(elapsed == 0)
+    return;
+
+  m_bitrate = (uint32_t)(bytes * 1000 / elapsed);
+  UpdateThreshold();
+
+  // report new overflows
+  uint32_t overflows = m_Ring->Overflows();
+
+  if(overflows != m_overflows)
+  {
+    ERRORLOG("receive buffer overflow (%u writes dropped, %u in total)", overflows - m_overflows, overflows);
+    m_overflows = overflows;
+  }
+
+  // remember the bitrate for the next session of the channel
+  if(m_bitrate > 0)
+  {
+    cMutexLock lock(&m_bitratesLock);
+    m_bitrates[m_uid] = m_bitrate;
+  }
+}
+
+void cLiveSession::UpdateThreshold()
+{
+  // wake the demuxer for the data of WakeupDelay ms (a few packets if the bitrate is unknown yet)
+  uint32_t threshold = (uint32_t)((uint64_t)m_bitrate * WakeupDelay / 1000);
+  threshold = std::max(threshold, (uint32_t)(MinWakeupPackets * TS_SIZE));
+  threshold = std::min(threshold, m_Ring->Capacity() / 4);
+
+  m_Ring->SetThreshold(threshold);
+}
+
+cString cLiveSession::Status()
+{
+  cMutexLock lock(&m_sessionsLock);
+
+  cString status = cString::sprintf("Live sessions: %i\n", (int)m_sessions.size());
+
+  for(std::map<uint32_t, cLiveSession*>::iterator i = m_sessions.begin(); i != m_sessions.end(); i++)
+  {
+    cLiveSession* session = i->second;
+    cSPSCRing* ring = session->m_Ring;
+
+    status = cString::sprintf("%sChannel %i - %s: %i client(s), %u kbit/s, buffer %u of %u KB, wakeup at %u KB, %u overflows (%llu KB lost)\n", (const char*)status,
+      session->m_Channel->Number(), session->m_Channel->Name(), session->m_refs, session->m_bitrate * 8 / 1000,
+      ring->Available() / 1024, ring->Capacity() / 1024, ring->Threshold() / 1024,
+      ring->Overflows(), (unsigned long long)(ring->OverflowBytes() / 1024));
+  }
+
+  return status;
+}
+
+void cLiveSession::UpdatePidTable()
+{
+  // build the new table aside and publish it with a single pointer store.
+  // The demux loop holds m_FilterMutex while using a table, so the old one
+  // can't be in use anymore.
+  cTSDemuxer **table = new cTSDemuxer*[PidTableSize];
+  memset(table, 0, PidTableSize * sizeof(cTSDemuxer*));
+
+  for (std::list<cTSDemuxer*>::iterator i = m_Demuxers.begin(); i != m_Demuxers.end(); i++)
+    if ((*i) != NULL)
+      table[(*i)->GetPID() & (PidTableSize - 1)] = (*i);
+
+  cTSDemuxer **old = m_PidTable;
+
+  __sync_synchronize();
+  m_PidTable = table;
+
+  delete[] old;
+}
+
+void cLiveSession::sendStreamPacket(sStreamPacket *pkt)
+{
+  bool bReady = IsReady();
+
+  if(!bReady || pkt == NULL || pkt->size == 0)
+    return;
+
+  // Send stream information as the first packet on startup
+  if (IsStarting() && bReady)
+  {
+    INFOLOG("streaming of channel started");
+    m_last_tick.Set(0);
+    RequestStreamChange();
+    m_startup = false;
+  }
+
+  // if a audio or video packet was sent, the signal is restored
+  if(m_SignalLost && (pkt->content == scVIDEO || pkt->content == scAUDIO)) {
+    INFOLOG("signal restored");
+    sendStatus(XVDR_STREAM_STATUS_SIGNALRESTORED);
+    m_SignalLost = false;
+    RequestStreamChange();
+    m_last_tick.Set(0);
+    return;
+  }
+
+  if(m_SignalLost)
+    return;
+
+  m_last_tick.Set(0);
+
+  cMutexLock lock(&m_FilterMutex);
+
+  if(m_Subscribers.empty())
+    return;
+
+  // 0 means "no serial"
+  if(++m_serial == 0)
+    m_serial = 1;
+
+  pkt->serial = m_serial;
+
+  // initialise stream packet
+  MsgPacket* packet = new MsgPacket(XVDR_STREAM_MUXPKT, XVDR_CHANNEL_STREAM);
+  packet->disablePayloadCheckSum();
+
+  // write stream data
+  packet->put_U16(pkt->pid);
+  packet->put_S64(pkt->pts);
+  packet->put_S64(pkt->dts);
+
+  // write payload into stream packet
+  packet->put_U32(pkt->size);
+
+  // attach the parsers frame buffer instead of copying it
+  if(pkt->buffer != NULL)
+  {
+    packet->put_Buffer(pkt->buffer, pkt->data - pkt->buffer->data(), pkt->size);
+  }
+  // copy the frame once for all clients
+  else if(m_Subscribers.size() > 1)
+  {
+    MsgBuffer* buffer = MsgBuffer::create(pkt->size);
+
+    if(buffer != NULL)
+    {
+      memcpy(buffer->data(), pkt->data, pkt->size);
+      packet->put_Buffer(buffer, 0, pkt->size);
+      buffer->unref();
+    }
+    else
+      packet->put_Blob(pkt->data, pkt->size);
+  }
+  else
+    packet->put_Blob(pkt->data, pkt->size);
+
+  Broadcast(packet, pkt);
+}
+
+void cLiveSession::sendStatus(int status)
+{
+  MsgPacket* packet = new MsgPacket(XVDR_STREAM_STATUS, XVDR_CHANNEL_STREAM);
+  packet->put_U32(status);
+  Broadcast(packet);
+}
+
+void cLiveSession::sendSignalInfo()
+{
+  /* If no frontend is found m_Frontend is set to -2, in this case
+     return a empty signalinfo package */
+  if (m_Frontend == -2)
+  {
+    MsgPacket* resp = new MsgPacket(XVDR_STREAM_SIGNALINFO, XVDR_CHANNEL_STREAM);
+
+    resp->put_String(*cString::sprintf("Unknown"));
+    resp->put_String(*cString::sprintf("Unknown"));
+    resp->put_U32(0);
+    resp->put_U32(0);
+    resp->put_U32(0);
+    resp->put_U32(0);
+
+    Broadcast(resp);
+    return;
+  }
+
+  if (m_Channel && ((m_Channel->Source() >> 24) == 'V'))
+  {
+    if (m_Frontend < 0)
+    {
+      for (int i = 0; i < 8; i++)
+      {
+        m_DeviceString = cString::sprintf("/dev/video%d", i);
+        m_Frontend = open(m_DeviceString, O_RDONLY | O_NONBLOCK);
+        if (m_Frontend >= 0)
+        {
+          if (ioctl(m_Frontend, VIDIOC_QUERYCAP, &m_vcap) < 0)
+          {
+            ERRORLOG("cannot read analog frontend info.");
+            close(m_Frontend);
+            m_Frontend = -1;
+            memset(&m_vcap, 0, sizeof(m_vcap));
+            continue;
+          }
+          break;
+        }
+      }
+      if (m_Frontend < 0)
+        m_Frontend = -2;
+    }
+
+    if (m_Frontend >= 0)
+    {
+      MsgPacket* resp = new MsgPacket(XVDR_STREAM_SIGNALINFO, XVDR_CHANNEL_STREAM);
+
+      resp->put_String(*cString::sprintf("Analog #%s - %s (%s)", *m_DeviceString, (char *) m_vcap.card, m_vcap.driver));
+      resp->put_String("");
+      resp->put_U32(0);
+      resp->put_U32(0);
+      resp->put_U32(0);
+      resp->put_U32(0);
+
+      Broadcast(resp);
+    }
+  }
+  else
+  {
+    if (m_Frontend < 0)
+    {
+      m_DeviceString = cString::sprintf(FRONTEND_DEVICE, m_Device->CardIndex(), 0);
+      m_Frontend = open(m_DeviceString, O_RDONLY | O_NONBLOCK);
+      if (m_Frontend >= 0)
+      {
+        if (ioctl(m_Frontend, FE_GET_INFO, &m_FrontendInfo) < 0)
+        {
+          ERRORLOG("cannot read frontend info.");
+          close(m_Frontend);
+          m_Frontend = -2;
+          memset(&m_FrontendInfo, 0, sizeof(m_FrontendInfo));
+          return;
+        }
+      }
+    }
+
+    if (m_Frontend >= 0)
+    {
+      MsgPacket* resp = new MsgPacket(XVDR_STREAM_SIGNALINFO, XVDR_CHANNEL_STREAM);
+
+      fe_status_t status;
+      uint16_t fe_snr;
+      uint16_t fe_signal;
+      uint32_t fe_ber;
+      uint32_t fe_unc;
+
+      memset(&status, 0, sizeof(status));
+      ioctl(m_Frontend, FE_READ_STATUS, &status);
+
+      if (ioctl(m_Frontend, FE_READ_SIGNAL_STRENGTH, &fe_signal) == -1)
+        fe_signal = -2;
+      if (ioctl(m_Frontend, FE_READ_SNR, &fe_snr) == -1)
+        fe_snr = -2;
+      if (ioctl(m_Frontend, FE_READ_BER, &fe_ber) == -1)
+        fe_ber = -2;
+      if (ioctl(m_Frontend, FE_READ_UNCORRECTED_BLOCKS, &fe_unc) == -1)
+        fe_unc = -2;
+
+      switch (m_Channel->Source() & cSource::st_Mask)
+      {
+        case cSource::stSat:
+          resp->put_String(*cString::sprintf("DVB-S%s #%d - %s", (m_FrontendInfo.caps & 0x10000000) ? "2" : "",  m_Device->DeviceNumber() + 1, m_FrontendInfo.name));
+          break;
+        case cSource::stCable:
+          resp->put_String(*cString::sprintf("DVB-C #%d - %s", m_Device->DeviceNumber() + 1, m_FrontendInfo.name));
+          break;
+        case cSource::stTerr:
+          resp->put_String(*cString::sprintf("DVB-T #%d - %s", m_Device->DeviceNumber(), m_FrontendInfo.name));
+          break;
+      }
+      resp->put_String(*cString::sprintf("%s:%s:%s:%s:%s", (status & FE_HAS_LOCK) ? "LOCKED" : "-", (status & FE_HAS_SIGNAL) ? "SIGNAL" : "-", (status & FE_HAS_CARRIER) ? "CARRIER" : "-", (status & FE_HAS_VITERBI) ? "VITERBI" : "-", (status & FE_HAS_SYNC) ? "SYNC" : "-"));
+      resp->put_U32(fe_snr);
+      resp->put_U32(fe_signal);
+      resp->put_U32(fe_ber);
+      resp->put_U32(fe_unc);
+
+      DEBUGLOG("sendSignalInfo");
+
+      Broadcast(resp);
+    }
+  }
+}
+
+void cLiveSession::sendStreamInfo()
+{
+  // every client gets the streams in its own order
+  cMutexLock lock(&m_FilterMutex);
+
+  for (std::list<cLiveStreamer*>::iterator i = m_Subscribers.begin(); i != m_Subscribers.end(); i++)
+    (*i)->sendStreamInfo();
+}
+
+void cLiveSession::GetStreams(std::list<cTSDemuxer*>& streams, int lang, eStreamType type)
+{
+  cMutexLock lock(&m_FilterMutex);
+
+  streams.clear();
+
+  // do not reorder if there isn't any preferred language
+  if (lang == -1 && type == stNONE)
+  {
+    streams = m_Demuxers;
+    return;
+  }
+
+  std::map<int, cTSDemuxer*> weight;
+
+  // compute weights
+  int i = 0;
+  for (std::list<cTSDemuxer*>::iterator idx = m_Demuxers.begin(); idx != m_Demuxers.end(); idx++, i++)
+  {
+    cTSDemuxer* stream = (*idx);
+    if (stream == NULL)
+      continue;
+
+    int w = i;
+
+    // video streams rule
+    if(stream->Content() == scVIDEO)
+      w = 100000;
+
+    // only for audio streams
+    if(stream->Content() != scAUDIO)
+    {
+      weight[w] = stream;
+      continue;
+    }
+
+    // weight of language (10000)
+    int streamLangIndex = I18nLanguageIndex(stream->GetLanguage());
+    w += (streamLangIndex == lang) ? 10000 : 0;
+
+    // weight of streamtype (1000)
+    w += (stream->Type() == type) ? 1000 : 0;
+
+    // weight of languagedescriptor (100)
+    int ldw = stream->GetAudioType() * 100;
+    w += 400 - ldw;
+
+    // summed weight
+    weight[w] = stream;
+  }
+
+  // order streams on weight
+  for(std::map<int, cTSDemuxer*>::reverse_iterator i = weight.rbegin(); i != weight.rend(); i++)
+  {
+    cTSDemuxer* stream = i->second;
+    DEBUGLOG("Stream : Type %i / %s Weight: %i", stream->Type(), stream->GetLanguage(), i->first);
+    streams.push_back(stream);
+  }
+}
+
+bool cLiveSession::IsReady()
+{
+  bool bAllParsed = true;
+
+  for (std::list<cTSDemuxer*>::iterator i = m_Demuxers.begin(); i != m_Demuxers.end(); i++)
+  {
+    if ((*i)->IsParsed())
+    {
+      if ((*i)->Content() == scVIDEO)
+      {
+        cChannelCache cache = cChannelCache::GetFromCache(m_uid);
+        cChannelCache::iterator info = cache.find((*i)->GetPID());
+        if(info != cache.end())
+        {
+          info->second.width = (*i)->GetWidth();
+          info->second.height = (*i)->GetHeight();
+          info->second.dar = (*i)->GetAspect();
+
+          // update cache information
+          cChannelCache::AddToCache(m_uid, cache);
+        }
+        return true;
+      }
+    }
+    else
+      bAllParsed = false;
+  }
+
+  return bAllParsed;
+}
@@ -0,0 +1,173 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#ifndef XVDR_LIVESESSION_H
+#define XVDR_LIVESESSION_H
+
+#include <stdint.h>
+#include <list>
+#include <map>
+#include <linux/dvb/frontend.h>
+#include <linux/videodev2.h>
+#include <vdr/channels.h>
+#include <vdr/device.h>
+#include <vdr/thread.h>
+
+#include "demuxer/demuxer.h"
+
+class cLiveHub;
+class cLivePatFilter;
+class cLiveStreamer;
+class MsgPacket;
+class cSPSCRing;
+
+// Receiving and demuxing pipeline of a channel. The channel is tuned only
+// once, all clients watching the same channel subscribe to the session of
+// the first one. Every demuxed frame is serialized into a single packet,
+// the subscribers get clones sharing its payload. The TS packets come from
+// the cLiveHub of the channel's transponder.
+
+class cLiveSession : public cThread
+{
+public:
+
+  // get the session of a channel (the channel is tuned if there is none).
+  // Returns NULL and puts the error code into "resp" on failure.
+  static cLiveSession* Acquire(const cChannel *channel, int priority, uint32_t timeout, MsgPacket* resp);
+
+  // drop a reference (the session is deleted with the last one)
+  static void Release(cLiveSession* session);
+
+  // start fanning out packets to a client (starts receiving with the first one)
+  void Subscribe(cLiveStreamer* streamer);
+
+  void Unsubscribe(cLiveStreamer* streamer);
+
+  // receiver: queue TS packets for the demuxers, returns the number of bytes stored
+  int Put(const uchar *Data, int Length);
+
+  bool IsReady();
+
+  bool IsStarting() { return m_startup; }
+
+  uint32_t ChannelUID() const { return m_uid; }
+
+  // demuxers in client order (sorted by the preferred language and stream type)
+  void GetStreams(std::list<cTSDemuxer*>& streams, int lang, eStreamType type);
+
+  // report of all sessions (SVDRP)
+  static cString Status();
+
+  enum
+  {
+    PidTableSize = 8192,      // 13 bit TS pids
+    ScanBatch = 64,           // TS headers classified at once
+    DefaultRingSize = 5 * 1024 * 1024,  // receive ring of a channel with unknown bitrate
+    MinRingSize = 1024 * 1024,
+    MaxRingSize = 16 * 1024 * 1024,
+    RingTime = 2,             // seconds of data the receive ring holds
+    WakeupDelay = 10,         // ms the demuxer may sleep while data is waiting
+    MinWakeupPackets = 7,     // wakeup threshold if the bitrate is unknown
+    IdleTimeout = 100         // ms between timeout checks without data
+  };
+
+protected:
+
+  virtual void Action(void);
+
+private:
+
+  friend class cTSDemuxer;
+  friend class cLivePatFilter;
+  friend class cChannelCache;
+
+  cLiveSession(const cChannel *channel, int priority, uint32_t timeout);
+
+  virtual ~cLiveSession();
+
+  bool Tune(MsgPacket* resp);
+
+
+  // rebuild the pid table from m_Demuxers (m_FilterMutex held or not receiving yet)
+  void UpdatePidTable();
+
+  void RequestStreamChange();
+
+  // measured consumption of the receive ring (bytes in "elapsed" ms)
+  void UpdateBitrate(uint64_t bytes, uint64_t elapsed);
+
+  void UpdateThreshold();
+
+  // priority and timeout of the session from its subscribers (m_FilterMutex held)
+  void UpdateSubscriberSettings();
+
+  uint32_t ScanTimeout();
+
+  void sendStreamPacket(sStreamPacket *pkt);
+  void sendSignalInfo();
+  void sendStreamInfo();
+  void sendStatus(int status);
+
+  // hand a packet to all subscribers (takes ownership)
+  void Broadcast(MsgPacket* packet, sStreamPacket* pkt = NULL);
+
+  const cChannel   *m_Channel;                      /*!> Channel to stream */
+  cDevice          *m_Device;                       /*!> The receiving device the channel depents to */
+  cLiveHub         *m_Hub;                          /*!> Receiver and PAT scanner of the transponder */
+  int               m_Priority;                     /*!> Highest priority of the subscribers */
+  std::list<cTSDemuxer*> m_Demuxers;
+  cTSDemuxer      **m_PidTable;                     /*!> Demuxer of each pid (PidTableSize entries, NULL: not demuxed) */
+  int               m_Frontend;                     /*!> File descriptor to access used receiving device  */
+  dvb_frontend_info m_FrontendInfo;                 /*!> DVB Information about the receiving device (DVB only) */
+  v4l2_capability   m_vcap;                         /*!> PVR Information about the receiving device (pvrinput only) */
+  cString           m_DeviceString;                 /*!> The name of the receiving device */
+  bool              m_startup;
+  uint32_t          m_scanTimeout;                  /*!> Shortest channel scanning timeout of the subscribers (in seconds) */
+  cTimeMs           m_last_tick;
+  bool              m_SignalLost;
+  cMutex            m_FilterMutex;                  /*!> Protects the demuxers and the subscribers */
+  std::list<cLiveStreamer*> m_Subscribers;
+  bool              m_receiving;
+  cSPSCRing        *m_Ring;                         /*!> TS packets from the receiver thread */
+  uint32_t          m_bitrate;                      /*!> Measured bitrate (bytes per second) */
+  uint32_t          m_overflows;                    /*!> Ring overflows already reported */
+  uint32_t          m_uid;
+  uint32_t          m_serial;                       /*!> Serial of the last broadcast packet */
+
+  // clients using the session (protected by m_sessionsLock)
+  int               m_refs;
+
+  static std::map<uint32_t, cLiveSession*> m_sessions;
+
+  static cMutex m_sessionsLock;
+
+  // last measured bitrate of each channel. Not guarded by m_sessionsLock, sessions
+  // are deleted (and their thread is joined) with that lock held.
+  static std::map<uint32_t, uint32_t> m_bitrates;
+
+  static cMutex m_bitratesLock;
+};
+
+#endif // XVDR_LIVESESSION_H
@@ -41,105 +41,43 @@
 
 #include "config/config.h"
 #include "net/msgpacket.h"
+#include "net/msgbuffer.h"
 #include "net/socketlock.h"
 #include "xvdr/xvdrcommand.h"
 #include "tools/hash.h"
 
 #include "livestreamer.h"
-#include "livepatfilter.h"
-#include "livereceiver.h"
+#include "livesession.h"
 #include "livequeue.h"
-#include "channelcache.h"
 
 cLiveStreamer::cLiveStreamer(uint32_t timeout)
- : cThread("cLiveStreamer stream processor")
- , cRingBufferLinear(MEGABYTE(5), TS_SIZE*2, true)
- , m_scanTimeout(timeout)
+ : m_scanTimeout(timeout)
 {
-  m_Channel         = NULL;
-  m_Priority        = 0;
+  m_Session         = NULL;
   m_socket          = -1;
-  m_Device          = NULL;
-  m_Receiver        = NULL;
+  m_Priority        = 0;
   m_Queue           = NULL;
-  m_PatFilter       = NULL;
-  m_Frontend        = -1;
-  m_startup         = true;
-  m_SignalLost      = false;
+  m_profile         = XVDR_STREAM_PROFILE_LOWLATENCY;
+  m_checksum        = true;
+  m_queueStatus     = false;
   m_LangStreamType  = stMPEG2AUDIO;
   m_LanguageIndex   = -1;
   m_uid             = 0;
 
   m_requestStreamChange = false;
-
-
-  memset(&m_FrontendInfo, 0, sizeof(m_FrontendInfo));
-
-  if(m_scanTimeout == 0)
-    m_scanTimeout = XVDRServerConfig.stream_timeout;
-
-  SetTimeouts(0, 50);
 }
 
 cLiveStreamer::~cLiveStreamer()
 {
   DEBUGLOG("Started to delete live streamer");
 
-  // clear buffer
-  Clear();
-
   cTimeMs t;
-  Cancel(-1);
 
-  if (m_Device)
+  // stop fanning out packets to us before the queue goes away
+  if (m_Session)
   {
-    if (m_Receiver)
-    {
-      DEBUGLOG("Detaching Live Receiver");
-      m_Device->Detach(m_Receiver);
-    }
-    else
-    {
-      DEBUGLOG("No live receiver present");
-    }
-
-    if (m_PatFilter)
-    {
-      DEBUGLOG("Detaching Live Filter");
-      m_Device->Detach(m_PatFilter);
-    }
-    else
-    {
-      DEBUGLOG("No live filter present");
-    }
-
-    if (m_Receiver)
-    {
-      DEBUGLOG("Deleting Live Receiver");
-      DELETENULL(m_Receiver);
-    }
-
-    if (m_PatFilter)
-    {
-      DEBUGLOG("Deleting Live Filter");
-      DELETENULL(m_PatFilter);
-    }
-
-    for (std::list<cTSDemuxer*>::iterator i = m_Demuxers.begin(); i != m_Demuxers.end(); i++)
-    {
-      if ((*i) != NULL)
-      {
-        DEBUGLOG("Deleting stream demuxer for pid=%i and type=%i", (*i)->GetPID(), (*i)->Type());
-        delete (*i);
-      }
-    }
-    m_Demuxers.clear();
-
-  }
-  if (m_Frontend >= 0)
-  {
-    close(m_Frontend);
-    m_Frontend = -1;
+    m_Session->Unsubscribe(this);
+    cLiveSession::Release(m_Session);
   }
 
   delete m_Queue;
@@ -152,148 +90,17 @@ void cLiveStreamer::RequestStreamChange()
   m_requestStreamChange = true;
 }
 
-void cLiveStreamer::Action(void)
-{
-  int size              = 0;
-  int used              = 0;
-  unsigned char *buf    = NULL;
-  m_startup             = true;
-
-  cTimeMs last_info;
-  last_info.Set(0);
-
-  while (Running())
-  {
-    size = 0;
-    used = 0;
-    buf = Get(size);
-
-    if (!m_Receiver->IsAttached())
-    {
-      INFOLOG("returning from streamer thread, receiver is no more attached");
-      break;
-    }
-
-    if(!IsStarting() && (m_last_tick.Elapsed() > (uint64_t)(m_scanTimeout*1000)) && !m_SignalLost)
-    {
-      INFOLOG("timeout. signal lost!");
-      sendStatus(XVDR_STREAM_STATUS_SIGNALLOST);
-      m_SignalLost = true;
-    }
-
-    // no data
-    if (buf == NULL || size <= TS_SIZE)
-      continue;
-
-    /* Make sure we are looking at a TS packet */
-    while (size > TS_SIZE)
-    {
-      if (buf[0] == TS_SYNC_BYTE && buf[TS_SIZE] == TS_SYNC_BYTE)
-        break;
-      used++;
-      buf++;
-      size--;
-    }
-
-    while (size >= TS_SIZE)
-    {
-      if(!Running())
-      {
-        break;
-      }
-
-      unsigned int ts_pid = TsPid(buf);
-
-      m_FilterMutex.Lock();
-      cTSDemuxer *demuxer = FindStreamDemuxer(ts_pid);
-      //INFOLOG("TS PID: %i", ts_pid);
-      if (demuxer)
-      {
-        demuxer->ProcessTSPacket(buf);
-      }
-      m_FilterMutex.Unlock();
-
-      buf += TS_SIZE;
-      size -= TS_SIZE;
-      used += TS_SIZE;
-    }
-    Del(used);
-
-    if(last_info.Elapsed() >= 10*1000 && IsReady())
-    {
-      last_info.Set(0);
-      sendStreamInfo();
-      sendSignalInfo();
-    }
-  }
-}
-
 bool cLiveStreamer::StreamChannel(const cChannel *channel, int priority, int sock, MsgPacket *resp)
 {
-  if (channel == NULL)
-  {
-    ERRORLOG("Starting streaming of channel without valid channel");
-    resp->put_U32(XVDR_RET_ERROR);
-    return false;
-  }
-
-  m_Channel  = channel;
+  // tune the channel or share it with other clients
   m_Priority = priority;
-  m_socket   = sock;
-  m_uid      = CreateChannelUID(m_Channel);
-
-  // check if any device is able to decrypt the channel - code taken from VDR
-  int NumUsableSlots = 0;
-
-  if (m_Channel->Ca() >= CA_ENCRYPTED_MIN) {
-    for (cCamSlot *CamSlot = CamSlots.First(); CamSlot; CamSlot = CamSlots.Next(CamSlot)) {
-      if (CamSlot->ModuleStatus() == msReady) {
-        if (CamSlot->ProvidesCa(m_Channel->Caids())) {
-          if (!ChannelCamRelations.CamChecked(m_Channel->GetChannelID(), CamSlot->SlotNumber())) {
-            NumUsableSlots++;
-          }
-       }
-      }
-    }
-    if (!NumUsableSlots) {
-      ERRORLOG("Unable to decrypt channel %i - %s", m_Channel->Number(), m_Channel->Name());
-      resp->put_U32(XVDR_RET_ENCRYPTED);
-      return false;
-    }
-  }
-
-  // get device for this channel
-  m_Device = cDevice::GetDevice(channel, m_Priority, true);
-
-  // try a bit harder if we can't find a device
-  if(m_Device == NULL)
-    m_Device = cDevice::GetDevice(channel, m_Priority, false);
-
-  INFOLOG("--------------------------------------");
-  INFOLOG("Channel streaming request: %i - %s", m_Channel->Number(), m_Channel->Name());
-
-  if (m_Device == NULL)
-  {
-    ERRORLOG("Can't get device for channel %i - %s", m_Channel->Number(), m_Channel->Name());
-
-    // return status "recording running" if there is an active timer
-    time_t now = time(NULL);
-    if(Timers.GetMatch(now) != NULL)
-      resp->put_U32(XVDR_RET_RECRUNNING);
-    else
-      resp->put_U32(XVDR_RET_DATALOCKED);
+  m_Session = cLiveSession::Acquire(channel, priority, m_scanTimeout, resp);
 
+  if (m_Session == NULL)
     return false;
-  }
-
-  INFOLOG("Found available device %d", m_Device->DeviceNumber() + 1);
 
-  if (!m_Device->SwitchChannel(m_Channel, false))
-  {
-    ERRORLOG("Can't switch to channel %i - %s", m_Channel->Number(), m_Channel->Name());
-    resp->put_U32(XVDR_RET_ERROR);
-    return false;
-  }
+  m_socket   = sock;
+  m_uid      = m_Session->ChannelUID();
 
   // Send the OK response here, that it is before the Stream end message
   resp->put_U32(XVDR_RET_OK);
@@ -306,123 +113,32 @@ bool cLiveStreamer::StreamChannel(const cChannel *channel, int priority, int soc
   // create send queue
   if (m_Queue == NULL)
   {
-    m_Queue = new cLiveQueue(m_socket);
-    m_Queue->Start();
-  }
-
-  m_PatFilter = new cLivePatFilter(this, m_Channel);
-  m_Receiver = new cLiveReceiver(this, m_Priority);
-
-  // get cached demuxer data
-  DEBUGLOG("Creating demuxers");
-  cChannelCache cache = cChannelCache::GetFromCache(m_uid);
-  if(cache.size() != 0) {
-    cache.CreateDemuxers(this);
-    RequestStreamChange();
-  }
+    m_Queue = new cLiveQueue(m_socket, m_uid);
+    m_Queue->SetProfile(m_profile);
 
-  DEBUGLOG("Starting PAT scanner");
-  m_Device->AttachFilter(m_PatFilter);
-  m_Device->AttachReceiver(m_Receiver);
+    if(!m_checksum)
+      m_Queue->DisableCheckSum();
 
-  INFOLOG("Successfully switched to channel %i - %s", m_Channel->Number(), m_Channel->Name());
-  return true;
-}
-
-cTSDemuxer *cLiveStreamer::FindStreamDemuxer(int Pid)
-{
-  for (std::list<cTSDemuxer*>::iterator i = m_Demuxers.begin(); i != m_Demuxers.end(); i++)
-    if ((*i) != NULL && (*i)->GetPID() == Pid)
-      return (*i);
-
-  return NULL;
-}
+    if(m_queueStatus)
+      m_Queue->EnableQueueStatus();
 
-void cLiveStreamer::Activate(bool On)
-{
-  if (On)
-  {
-    DEBUGLOG("VDR active, sending stream start message");
-    Start();
-  }
-  else
-  {
-    DEBUGLOG("VDR inactive, sending stream end message");
-    Cancel(5);
+    m_Queue->Start();
   }
-}
 
-void cLiveStreamer::Attach(void)
-{
-  DEBUGLOG("%s", __FUNCTION__);
-  if (m_Device)
-  {
-    if (m_Receiver)
-    {
-      m_Device->Detach(m_Receiver);
-      m_Device->AttachReceiver(m_Receiver);
-    }
-  }
-}
+  // a client joining a running session needs the current streams first
+  m_requestStreamChange = true;
+  m_Session->Subscribe(this);
 
-void cLiveStreamer::Detach(void)
-{
-  DEBUGLOG("%s", __FUNCTION__);
-  if (m_Device)
-  {
-    if (m_Receiver)
-      m_Device->Detach(m_Receiver);
-  }
+  return true;
 }
 
-void cLiveStreamer::sendStreamPacket(sStreamPacket *pkt)
+void cLiveStreamer::sendPacket(MsgPacket* packet, sStreamPacket *pkt)
 {
-  bool bReady = IsReady();
-
-  if(!bReady || pkt == NULL || pkt->size == 0)
-    return;
-
-  // Send stream information as the first packet on startup
-  if (IsStarting() && bReady)
-  {
-    INFOLOG("streaming of channel started");
-    m_last_tick.Set(0);
-    m_requestStreamChange = true;
-    m_startup = false;
-  }
-
-  // send stream change on demand
-  if(m_requestStreamChange)
+  // send stream change on demand (in front of the next stream packet)
+  if(pkt != NULL && m_requestStreamChange)
     sendStreamChange();
 
-  // if a audio or video packet was sent, the signal is restored
-  if(m_SignalLost && (pkt->content == scVIDEO || pkt->content == scAUDIO)) {
-    INFOLOG("signal restored");
-    sendStatus(XVDR_STREAM_STATUS_SIGNALRESTORED);
-    m_SignalLost = false;
-    m_requestStreamChange = true;
-    m_last_tick.Set(0);
-    return;
-  }
-
-  if(m_SignalLost)
-    return;
-
-  // initialise stream packet
-  MsgPacket* packet = new MsgPacket(XVDR_STREAM_MUXPKT, XVDR_CHANNEL_STREAM);
-  packet->disablePayloadCheckSum();
-
-  // write stream data
-  packet->put_U16(pkt->pid);
-  packet->put_S64(pkt->pts);
-  packet->put_S64(pkt->dts);
-
-  // write payload into stream packet
-  packet->put_U32(pkt->size);
-  packet->put_Blob(pkt->data, pkt->size);
-
-  m_Queue->Add(packet);
-  m_last_tick.Set(0);
+  m_Queue->Add(packet, pkt);
 }
 
 void cLiveStreamer::sendStreamChange()
@@ -431,10 +147,11 @@ void cLiveStreamer::sendStreamChange()
 
   DEBUGLOG("sendStreamChange");
 
-  // reorder streams as preferred
-  reorderStreams(m_LanguageIndex, m_LangStreamType);
+  // streams in preferred order
+  std::list<cTSDemuxer*> streams;
+  m_Session->GetStreams(streams, m_LanguageIndex, m_LangStreamType);
 
-  for (std::list<cTSDemuxer*>::iterator idx = m_Demuxers.begin(); idx != m_Demuxers.end(); idx++)
+  for (std::list<cTSDemuxer*>::iterator idx = streams.begin(); idx != streams.end(); idx++)
   {
     cTSDemuxer* stream = (*idx);
 
@@ -538,148 +255,18 @@ void cLiveStreamer::sendStreamChange()
   sendStreamInfo();
 }
 
-void cLiveStreamer::sendStatus(int status)
-{
-  MsgPacket* packet = new MsgPacket(XVDR_STREAM_STATUS, XVDR_CHANNEL_STREAM);
-  packet->put_U32(status);
-  m_Queue->Add(packet);
-}
-
-void cLiveStreamer::sendSignalInfo()
-{
-  /* If no frontend is found m_Frontend is set to -2, in this case
-     return a empty signalinfo package */
-  if (m_Frontend == -2)
-  {
-    MsgPacket* resp = new MsgPacket(XVDR_STREAM_SIGNALINFO, XVDR_CHANNEL_STREAM);
-
-    resp->put_String(*cString::sprintf("Unknown"));
-    resp->put_String(*cString::sprintf("Unknown"));
-    resp->put_U32(0);
-    resp->put_U32(0);
-    resp->put_U32(0);
-    resp->put_U32(0);
-
-    m_Queue->Add(resp);
-    return;
-  }
-
-  if (m_Channel && ((m_Channel->Source() >> 24) == 'V'))
-  {
-    if (m_Frontend < 0)
-    {
-      for (int i = 0; i < 8; i++)
-      {
-        m_DeviceString = cString::sprintf("/dev/video%d", i);
-        m_Frontend = open(m_DeviceString, O_RDONLY | O_NONBLOCK);
-        if (m_Frontend >= 0)
-        {
-          if (ioctl(m_Frontend, VIDIOC_QUERYCAP, &m_vcap) < 0)
-          {
-            ERRORLOG("cannot read analog frontend info.");
-            close(m_Frontend);
-            m_Frontend = -1;
-            memset(&m_vcap, 0, sizeof(m_vcap));
-            continue;
-          }
-          break;
-        }
-      }
-      if (m_Frontend < 0)
-        m_Frontend = -2;
-    }
-
-    if (m_Frontend >= 0)
-    {
-      MsgPacket* resp = new MsgPacket(XVDR_STREAM_SIGNALINFO, XVDR_CHANNEL_STREAM);
-
-      resp->put_String(*cString::sprintf("Analog #%s - %s (%s)", *m_DeviceString, (char *) m_vcap.card, m_vcap.driver));
-      resp->put_String("");
-      resp->put_U32(0);
-      resp->put_U32(0);
-      resp->put_U32(0);
-      resp->put_U32(0);
-
-      m_Queue->Add(resp);
-    }
-  }
-  else
-  {
-    if (m_Frontend < 0)
-    {
-      m_DeviceString = cString::sprintf(FRONTEND_DEVICE, m_Device->CardIndex(), 0);
-      m_Frontend = open(m_DeviceString, O_RDONLY | O_NONBLOCK);
-      if (m_Frontend >= 0)
-      {
-        if (ioctl(m_Frontend, FE_GET_INFO, &m_FrontendInfo) < 0)
-        {
-          ERRORLOG("cannot read frontend info.");
-          close(m_Frontend);
-          m_Frontend = -2;
-          memset(&m_FrontendInfo, 0, sizeof(m_FrontendInfo));
-          return;
-        }
-      }
-    }
-
-    if (m_Frontend >= 0)
-    {
-      MsgPacket* resp = new MsgPacket(XVDR_STREAM_SIGNALINFO, XVDR_CHANNEL_STREAM);
-
-      fe_status_t status;
-      uint16_t fe_snr;
-      uint16_t fe_signal;
-      uint32_t fe_ber;
-      uint32_t fe_unc;
-
-      memset(&status, 0, sizeof(status));
-      ioctl(m_Frontend, FE_READ_STATUS, &status);
-
-      if (ioctl(m_Frontend, FE_READ_SIGNAL_STRENGTH, &fe_signal) == -1)
-        fe_signal = -2;
-      if (ioctl(m_Frontend, FE_READ_SNR, &fe_snr) == -1)
-        fe_snr = -2;
-      if (ioctl(m_Frontend, FE_READ_BER, &fe_ber) == -1)
-        fe_ber = -2;
-      if (ioctl(m_Frontend, FE_READ_UNCORRECTED_BLOCKS, &fe_unc) == -1)
-        fe_unc = -2;
-
-      switch (m_Channel->Source() & cSource::st_Mask)
-      {
-        case cSource::stSat:
-          resp->put_String(*cString::sprintf("DVB-S%s #%d - %s", (m_FrontendInfo.caps & 0x10000000) ? "2" : "",  m_Device->DeviceNumber() + 1, m_FrontendInfo.name));
-          break;
-        case cSource::stCable:
-          resp->put_String(*cString::sprintf("DVB-C #%d - %s", m_Device->DeviceNumber() + 1, m_FrontendInfo.name));
-          break;
-        case cSource::stTerr:
-          resp->put_String(*cString::sprintf("DVB-T #%d - %s", m_Device->DeviceNumber(), m_FrontendInfo.name));
-          break;
-      }
-      resp->put_String(*cString::sprintf("%s:%s:%s:%s:%s", (status & FE_HAS_LOCK) ? "LOCKED" : "-", (status & FE_HAS_SIGNAL) ? "SIGNAL" : "-", (status & FE_HAS_CARRIER) ? "CARRIER" : "-", (status & FE_HAS_VITERBI) ? "VITERBI" : "-", (status & FE_HAS_SYNC) ? "SYNC" : "-"));
-      resp->put_U32(fe_snr);
-      resp->put_U32(fe_signal);
-      resp->put_U32(fe_ber);
-      resp->put_U32(fe_unc);
-
-      DEBUGLOG("sendSignalInfo");
-
-      m_Queue->Add(resp);
-    }
-  }
-}
-
 void cLiveStreamer::sendStreamInfo()
 {
-  if(m_Demuxers.size() == 0)
+  // streams in preferred order
+  std::list<cTSDemuxer*> streams;
+  m_Session->GetStreams(streams, m_LanguageIndex, m_LangStreamType);
+
+  if(streams.size() == 0)
     return;
 
   MsgPacket* resp = new MsgPacket(XVDR_STREAM_CONTENTINFO, XVDR_CHANNEL_STREAM);
 
-  // reorder streams as preferred
-  reorderStreams(m_LanguageIndex, m_LangStreamType);
-
-  for (std::list<cTSDemuxer*>::iterator idx = m_Demuxers.begin(); idx != m_Demuxers.end(); idx++)
+  for (std::list<cTSDemuxer*>::iterator idx = streams.begin(); idx != streams.end(); idx++)
   {
     cTSDemuxer* stream = (*idx);
 
@@ -723,118 +310,74 @@ void cLiveStreamer::sendStreamInfo()
   m_Queue->Add(resp);
 }
 
-void cLiveStreamer::reorderStreams(int lang, eStreamType type)
+void cLiveStreamer::SetLanguage(int lang, eStreamType streamtype)
 {
-  // do not reorder if there isn't any preferred language
-  if (lang == -1 && type == stNONE)
+  if(lang == -1)
     return;
 
-  std::map<int, cTSDemuxer*> weight;
-
-  // compute weights
-  int i = 0;
-  for (std::list<cTSDemuxer*>::iterator idx = m_Demuxers.begin(); idx != m_Demuxers.end(); idx++, i++)
-  {
-    cTSDemuxer* stream = (*idx);
-    if (stream == NULL)
-      continue;
-
-    int w = i;
-
-    // video streams rule
-    if(stream->Content() == scVIDEO)
-      w = 100000;
+  m_LanguageIndex = lang;
+  m_LangStreamType = streamtype;
+}
 
-    // only for audio streams
-    if(stream->Content() != scAUDIO)
-    {
-      weight[w] = stream;
-      continue;
-    }
+void cLiveStreamer::SetProfile(int profile)
+{
+  m_profile = profile;
 
-    // weight of language (10000)
-    int streamLangIndex = I18nLanguageIndex(stream->GetLanguage());
-    w += (streamLangIndex == lang) ? 10000 : 0;
+  if(m_Queue != NULL)
+    m_Queue->SetProfile(profile);
+}
 
-    // weight of streamtype (1000)
-    w += (stream->Type() == type) ? 1000 : 0;
+void cLiveStreamer::DisableCheckSum()
+{
+  m_checksum = false;
 
-    // weight of languagedescriptor (100)
-    int ldw = stream->GetAudioType() * 100;
-    w += 400 - ldw;
+  if(m_Queue != NULL)
+    m_Queue->DisableCheckSum();
+}
 
-    // summed weight
-    weight[w] = stream;
-  }
+void cLiveStreamer::EnableQueueStatus()
+{
+  m_queueStatus = true;
 
-  // lock processing
-  m_FilterMutex.Lock();
+  if(m_Queue != NULL)
+    m_Queue->EnableQueueStatus();
+}
 
-  // reorder streams on weight
-  int idx = 0;
-  m_Demuxers.clear();
-  for(std::map<int, cTSDemuxer*>::reverse_iterator i = weight.rbegin(); i != weight.rend(); i++, idx++)
-  {
-    cTSDemuxer* stream = i->second;
-    DEBUGLOG("Stream : Type %i / %s Weight: %i", stream->Type(), stream->GetLanguage(), i->first);
-    m_Demuxers.push_back(stream);
-  }
+void cLiveStreamer::Pause(bool on, bool spill) {
+  if(m_Queue == NULL)
+    return;
 
-  // unlock processing
-  m_FilterMutex.Unlock();
+  m_Queue->Pause(on, spill);
 }
 
-void cLiveStreamer::SetLanguage(int lang, eStreamType streamtype)
+void cLiveStreamer::RequestPacket()
 {
-  if(lang == -1)
+  if(m_Queue == NULL)
     return;
 
-  m_LanguageIndex = lang;
-  m_LangStreamType = streamtype;
+  m_Queue->Request();
 }
 
-bool cLiveStreamer::IsReady()
+bool cLiveStreamer::Seek(int64_t time, bool relative, sTimeShiftPosition& pos)
 {
-  bool bAllParsed = true;
-
-  for (std::list<cTSDemuxer*>::iterator i = m_Demuxers.begin(); i != m_Demuxers.end(); i++)
-  {
-    if ((*i)->IsParsed())
-    {
-      if ((*i)->Content() == scVIDEO)
-      {
-        cChannelCache cache = cChannelCache::GetFromCache(m_uid);
-        cChannelCache::iterator info = cache.find((*i)->GetPID());
-        if(info != cache.end())
-        {
-          info->second.width = (*i)->GetWidth();
-          info->second.height = (*i)->GetHeight();
-          info->second.dar = (*i)->GetAspect();
-
-          // update cache information
-          cChannelCache::AddToCache(m_uid, cache);
-        }
-        return true;
-      }
-    }
-    else
-      bAllParsed = false;
-  }
+  if(m_Queue == NULL)
+    return false;
 
-  return bAllParsed;
+  return m_Queue->Seek(time, relative, pos);
 }
 
-void cLiveStreamer::Pause(bool on) {
+bool cLiveStreamer::NextKeyFrame(bool forward, sTimeShiftPosition& pos)
+{
   if(m_Queue == NULL)
-    return;
+    return false;
 
-  m_Queue->Pause(on);
+  return m_Queue->NextKeyFrame(forward, pos);
 }
 
-void cLiveStreamer::RequestPacket()
+bool cLiveStreamer::GetTimeShiftRange(sTimeShiftPosition& first, sTimeShiftPosition& last, sTimeShiftPosition& current)
 {
   if(m_Queue == NULL)
-    return;
+    return false;
 
-  m_Queue->Request();
+  return m_Queue->GetTimeShiftRange(first, last, current);
 }
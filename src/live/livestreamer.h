@@ -26,82 +26,59 @@
 #ifndef XVDR_RECEIVER_H
 #define XVDR_RECEIVER_H
 
-#include <linux/dvb/frontend.h>
-#include <linux/videodev2.h>
 #include <vdr/channels.h>
-#include <vdr/device.h>
-#include <vdr/receiver.h>
-#include <vdr/thread.h>
-#include <vdr/ringbuffer.h>
 
 #include "demuxer/demuxer.h"
 #include <list>
 
 class cChannel;
-class cLiveReceiver;
 class cTSDemuxer;
 class MsgPacket;
-class cLivePatFilter;
 class cLiveQueue;
+class cLiveSession;
+struct sTimeShiftPosition;
 
-class cLiveStreamer : public cThread
-                    , public cRingBufferLinear
+// Live stream of a client. The channel is received by a (shared) cLiveSession,
+// the streamer applies the client's stream order and feeds its send queue.
+
+class cLiveStreamer
 {
 private:
-  friend class cTSDemuxer;
-  friend class cLivePatFilter;
-  friend class cChannelCache;
-
-  void Detach(void);
-  void Attach(void);
-  cTSDemuxer *FindStreamDemuxer(int Pid);
-
-  void reorderStreams(int lang, eStreamType type);
+  friend class cLiveSession;
 
-  void sendStreamPacket(sStreamPacket *pkt);
+  void sendPacket(MsgPacket* packet, sStreamPacket *pkt);
   void sendStreamChange();
-  void sendSignalInfo();
   void sendStreamInfo();
-  void sendStatus(int status);
 
-  const cChannel   *m_Channel;                      /*!> Channel to stream */
-  cDevice          *m_Device;                       /*!> The receiving device the channel depents to */
-  cLiveReceiver    *m_Receiver;                     /*!> Our stream transceiver */
-  cLivePatFilter   *m_PatFilter;                    /*!> Filter processor to get changed pid's */
-  int               m_Priority;                     /*!> The priority over other streamers */
-  std::list<cTSDemuxer*> m_Demuxers;
+  void RequestStreamChange();
+
+  cLiveSession     *m_Session;                      /*!> The receiving session of the channel */
   int               m_socket;                       /*!> The socket class to communicate with client */
-  int               m_Frontend;                     /*!> File descriptor to access used receiving device  */
-  dvb_frontend_info m_FrontendInfo;                 /*!> DVB Information about the receiving device (DVB only) */
-  v4l2_capability   m_vcap;                         /*!> PVR Information about the receiving device (pvrinput only) */
-  cString           m_DeviceString;                 /*!> The name of the receiving device */
-  bool              m_startup;
   bool              m_requestStreamChange;
   uint32_t          m_scanTimeout;                  /*!> Channel scanning timeout (in seconds) */
-  cTimeMs           m_last_tick;
-  bool              m_SignalLost;
-  cMutex            m_FilterMutex;
+  int               m_Priority;                     /*!> The priority over other streamers */
   int               m_LanguageIndex;
   eStreamType       m_LangStreamType;
   cLiveQueue*       m_Queue;
+  int               m_profile;                      /*!> Stream profile (low latency / throughput) */
+  bool              m_checksum;                     /*!> Send header checksums */
+  bool              m_queueStatus;                  /*!> Report the queue state to the client */
   uint32_t          m_uid;
 
-protected:
-  virtual void Action(void);
-  void RequestStreamChange();
-
 public:
   cLiveStreamer(uint32_t timeout = 0);
   virtual ~cLiveStreamer();
 
-  void Activate(bool On);
-
   bool StreamChannel(const cChannel *channel, int priority, int sock, MsgPacket* resp);
-  bool IsReady();
-  bool IsStarting() { return m_startup; }
   void SetLanguage(int lang, eStreamType streamtype = stAC3);
-  void Pause(bool on);
+  void SetProfile(int profile);
+  void DisableCheckSum();
+  void EnableQueueStatus();
+  void Pause(bool on, bool spill = false);
   void RequestPacket();
+  bool Seek(int64_t time, bool relative, sTimeShiftPosition& pos);
+  bool NextKeyFrame(bool forward, sTimeShiftPosition& pos);
+  bool GetTimeShiftRange(sTimeShiftPosition& first, sTimeShiftPosition& last, sTimeShiftPosition& current);
 
 };
 
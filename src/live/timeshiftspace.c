@@ -0,0 +1,242 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <sys/statvfs.h>
+
+#include "config/config.h"
+#include "timeshiftspace.h"
+#include "timeshiftstore.h"
+
+static unsigned long long ToMB(uint64_t bytes)
+{
+  return bytes / (1024 * 1024);
+}
+
+uint64_t cTimeShiftSpace::TotalSize = 0;
+uint64_t cTimeShiftSpace::MinFree = 1024 * 1024 * 1024;
+cString cTimeShiftSpace::Directory = "/video";
+std::list<cTimeShiftStore*> cTimeShiftSpace::m_stores;
+uint64_t cTimeShiftSpace::m_lastCheck = 0;
+cMutex cTimeShiftSpace::m_lock;
+
+void cTimeShiftSpace::SetTotalSize(uint64_t bytes)
+{
+  TotalSize = bytes;
+  DEBUGLOG("Timeshift total size: %llu bytes", (unsigned long long)TotalSize);
+}
+
+void cTimeShiftSpace::SetMinFree(uint64_t bytes)
+{
+  MinFree = bytes;
+  DEBUGLOG("Timeshift minimum free space: %llu bytes", (unsigned long long)MinFree);
+}
+
+void cTimeShiftSpace::SetDirectory(const cString& dir)
+{
+  cMutexLock lock(&m_lock);
+  Directory = dir;
+}
+
+void cTimeShiftSpace::Register(cTimeShiftStore* store)
+{
+  cMutexLock lock(&m_lock);
+  m_stores.push_back(store);
+}
+
+void cTimeShiftSpace::Unregister(cTimeShiftStore* store)
+{
+  cMutexLock lock(&m_lock);
+  m_stores.remove(store);
+}
+
+uint64_t cTimeShiftSpace::FreeSpace()
+{
+  struct statvfs st;
+
+  if(statvfs(Directory, &st) != 0)
+    return (uint64_t)-1;
+
+  return (uint64_t)st.f_bavail * st.f_frsize;
+}
+
+uint64_t cTimeShiftSpace::DiskUsage(int& count, cTimeShiftStore* except)
+{
+  uint64_t used = 0;
+  count = 0;
+
+  for(std::list<cTimeShiftStore*>::iterator i = m_stores.begin(); i != m_stores.end(); i++)
+  {
+    if(*i == except || !(*i)->IsSpilled())
+      continue;
+
+    used += (*i)->DiskUsage();
+    count++;
+  }
+
+  return used;
+}
+
+uint64_t cTimeShiftSpace::Shrink(uint64_t bytes, uint64_t floor, cTimeShiftStore* except)
+{
+  uint64_t freed = 0;
+
+  for(std::list<cTimeShiftStore*>::iterator i = m_stores.begin(); i != m_stores.end() && freed < bytes; i++)
+  {
+    cTimeShiftStore* store = *i;
+
+    if(store == except || !store->IsSpilled())
+      continue;
+
+    uint64_t used = store->DiskUsage();
+
+    if(used <= floor)
+      continue;
+
+    uint64_t cut = bytes - freed;
+
+    if(cut > used - floor)
+      cut = used - floor;
+
+    store->Shrink(used - cut);
+    freed += used - store->DiskUsage();
+
+    INFOLOG("Timeshift buffer of channel %08x shrunk to %llu MB", store->ChannelUID(), ToMB(store->DiskUsage()));
+  }
+
+  return freed;
+}
+
+uint64_t cTimeShiftSpace::Grant(cTimeShiftStore* store, uint64_t size)
+{
+  cMutexLock lock(&m_lock);
+
+  uint64_t minimum = cTimeShiftStore::MinBlocks * cTimeShiftStore::BlockSize;
+  uint64_t granted = size;
+  int count = 0;
+  uint64_t used = DiskUsage(count, store);
+
+  // make room in the total budget, but every buffer keeps its fair share
+  if(TotalSize > 0 && used + granted > TotalSize)
+  {
+    used -= Shrink(used + granted - TotalSize, TotalSize / (count + 1), store);
+    granted = (TotalSize > used) ? TotalSize - used : 0;
+  }
+
+  // the recordings need the space more urgently
+  uint64_t available = FreeSpace();
+
+  if(MinFree > 0 && available != (uint64_t)-1)
+  {
+    uint64_t room = (available > MinFree) ? available - MinFree : 0;
+
+    if(room < granted)
+      room += Shrink(granted - room, minimum, store);
+
+    if(room < granted)
+      granted = room;
+  }
+
+  granted = (granted / cTimeShiftStore::BlockSize) * cTimeShiftStore::BlockSize;
+
+  if(granted < minimum)
+  {
+    ERRORLOG("No space left for the timeshift buffer of channel %08x", store->ChannelUID());
+    return 0;
+  }
+
+  if(granted < size)
+    INFOLOG("Timeshift buffer of channel %08x limited to %llu MB", store->ChannelUID(), ToMB(granted));
+
+  return granted;
+}
+
+void cTimeShiftSpace::Check()
+{
+  uint64_t now = cTimeShiftStore::Now();
+
+  // called by every writer run, avoid the lock if possible
+  if(now < m_lastCheck + CheckInterval)
+    return;
+
+  cMutexLock lock(&m_lock);
+
+  if(now < m_lastCheck + CheckInterval)
+    return;
+
+  m_lastCheck = now;
+
+  int count = 0;
+  uint64_t used = DiskUsage(count);
+  uint64_t excess = 0;
+
+  if(count == 0)
+    return;
+
+  if(TotalSize > 0 && used > TotalSize)
+    excess = used - TotalSize;
+
+  uint64_t available = FreeSpace();
+
+  if(MinFree > 0 && available != (uint64_t)-1 && available < MinFree && MinFree - available > excess)
+    excess = MinFree - available;
+
+  if(excess == 0)
+    return;
+
+  INFOLOG("Timeshift buffers exceed their space by %llu MB, shrinking", ToMB(excess));
+  Shrink(excess, cTimeShiftStore::MinBlocks * cTimeShiftStore::BlockSize);
+}
+
+cString cTimeShiftSpace::Status()
+{
+  cMutexLock lock(&m_lock);
+
+  int count = 0;
+  uint64_t used = DiskUsage(count);
+  uint64_t memory = 0;
+  uint64_t available = FreeSpace();
+
+  for(std::list<cTimeShiftStore*>::iterator i = m_stores.begin(); i != m_stores.end(); i++)
+    memory += (*i)->MemoryUsage();
+
+  cString status = cString::sprintf("Timeshift buffers: %i (%i on disk), memory %llu MB, disk %llu MB\n",
+    (int)m_stores.size(), count, ToMB(memory), ToMB(used));
+
+  status = cString::sprintf("%sDirectory: %s, free %llu MB\n", (const char*)status, (const char*)Directory,
+    (available == (uint64_t)-1) ? 0 : ToMB(available));
+
+  status = cString::sprintf("%sLimits: total %llu MB, minimum free %llu MB\n", (const char*)status,
+    ToMB(TotalSize), ToMB(MinFree));
+
+  for(std::list<cTimeShiftStore*>::iterator i = m_stores.begin(); i != m_stores.end(); i++)
+  {
+    cTimeShiftStore* store = *i;
+
+    status = cString::sprintf("%sChannel %08x: %i client(s), memory %llu MB, disk %llu MB of %llu MB\n", (const char*)status,
+      store->ChannelUID(), store->Clients(), ToMB(store->MemoryUsage()),
+      ToMB(store->DiskUsage()), ToMB(store->IsSpilled() ? store->Capacity() : 0));
+  }
+
+  return status;
+}
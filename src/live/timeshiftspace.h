@@ -0,0 +1,97 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef XVDR_TIMESHIFTSPACE_H
+#define XVDR_TIMESHIFTSPACE_H
+
+#include <stdint.h>
+#include <list>
+#include <vdr/thread.h>
+#include <vdr/tools.h>
+
+class cTimeShiftStore;
+
+// Disk space bookkeeping of all timeshift buffers.
+// Every store is registered here. A store asks for the size of its ring
+// file before it spills (Grant()), the writer threads call Check()
+// regularly. If the buffers exceed the total budget or the free space of
+// the timeshift filesystem drops below the watermark, the oldest buffers
+// are shrunk (see cTimeShiftStore::Shrink()).
+
+class cTimeShiftSpace
+{
+public:
+
+  static void Register(cTimeShiftStore* store);
+
+  static void Unregister(cTimeShiftStore* store);
+
+  // size of a new ring file (at most "size", 0 if there's no space left)
+  static uint64_t Grant(cTimeShiftStore* store, uint64_t size);
+
+  // enforce the limits (rate limited, any thread)
+  static void Check();
+
+  // usage report (SVDRP)
+  static cString Status();
+
+  // maximum disk space of all buffers (0: unlimited)
+  static void SetTotalSize(uint64_t bytes);
+
+  // free space to leave on the timeshift filesystem (0: don't care)
+  static void SetMinFree(uint64_t bytes);
+
+  static void SetDirectory(const cString& dir);
+
+  enum
+  {
+    CheckInterval = 1000    // ms between two checks
+  };
+
+private:
+
+  // bytes on the disk and number of buffers on the disk (m_lock held)
+  static uint64_t DiskUsage(int& count, cTimeShiftStore* except = NULL);
+
+  // shrink the oldest buffers down to "floor" (m_lock held), returns the bytes freed
+  static uint64_t Shrink(uint64_t bytes, uint64_t floor, cTimeShiftStore* except = NULL);
+
+  // available space of the timeshift filesystem ((uint64_t)-1 if unknown)
+  static uint64_t FreeSpace();
+
+  static uint64_t TotalSize;
+
+  static uint64_t MinFree;
+
+  static cString Directory;
+
+  // stores, oldest first
+  static std::list<cTimeShiftStore*> m_stores;
+
+  static uint64_t m_lastCheck;
+
+  static cMutex m_lock;
+};
+
+#endif // XVDR_TIMESHIFTSPACE_H
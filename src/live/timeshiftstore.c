@@ -0,0 +1,1010 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/time.h>
+
+#include "config/config.h"
+#include "demuxer/demuxer.h"
+#include "net/msgpacket.h"
+#include "net/msgreader.h"
+#include "timeshiftspace.h"
+#include "timeshiftstore.h"
+
+bool cTimeShiftStore::DirectIO = false;
+int cTimeShiftStore::MemoryWindow = 60;
+uint64_t cTimeShiftStore::MemorySize = 64 * 1024 * 1024;
+std::map<uint32_t, cTimeShiftStore*> cTimeShiftStore::m_stores;
+cMutex cTimeShiftStore::m_storesLock;
+std::vector<uint8_t*> cTimeShiftStore::m_blockPool;
+cMutex cTimeShiftStore::m_poolLock;
+
+cTimeShiftStore::cTimeShiftStore(const cString& filename, uint64_t size) : cThread("XVDR TimeShift Writer"),
+  m_filename(filename), m_fd(-1), m_limit(0), m_shrink(0), m_memBlocks(0), m_ring(NULL), m_ringTime(NULL), m_ringSize(0), m_blockStart(0), m_blockFill(0),
+  m_memTail(0), m_diskStart(0), m_diskEnd(0), m_tail(0), m_head(0), m_spill(0), m_spillFailed(false),
+  m_queue(QueueSize), m_dropped(0), m_channeluid(0), m_refs(0), m_feeder(NULL),
+  m_appendSerial(0), m_lastStart(0)
+{
+  m_newest.position = 0;
+  m_newest.time = 0;
+  m_newest.pts = DVD_NOPTS_VALUE;
+  m_newest.keyframe = false;
+
+  // whole blocks only, so a block never wraps around
+  m_capacity = (size / BlockSize) * BlockSize;
+
+  if(m_capacity < MinBlocks * BlockSize)
+    m_capacity = MinBlocks * BlockSize;
+
+  // without memory window the blocks are just a write cache
+  m_ringSize = (MemoryWindow > 0) ? MemorySize / BlockSize : MinBlocks;
+
+  if(m_ringSize < MinBlocks)
+    m_ringSize = MinBlocks;
+
+  m_ring = new uint8_t*[m_ringSize];
+  m_ringTime = new uint64_t[m_ringSize];
+
+  for(uint32_t i = 0; i < m_ringSize; i++)
+  {
+    m_ring[i] = NULL;
+    m_ringTime[i] = 0;
+  }
+}
+
+cTimeShiftStore::~cTimeShiftStore()
+{
+  cTimeShiftSpace::Unregister(this);
+
+  Cancel(-1);
+  m_queue.Wakeup();
+  Cancel(3);
+
+  sAppendItem item;
+  while(m_queue.Pop(item))
+    delete item.packet;
+
+  if(m_dropped > 0)
+    INFOLOG("Timeshift writer: %llu packets dropped", (unsigned long long)m_dropped);
+
+  if(m_fd != -1)
+  {
+    close(m_fd);
+    unlink(m_filename);
+  }
+
+  for(uint32_t i = 0; i < m_ringSize; i++)
+    ReleaseBlock(m_ring[i]);
+
+  delete[] m_ring;
+  delete[] m_ringTime;
+}
+
+void cTimeShiftStore::SetDirectIO(bool on)
+{
+  DirectIO = on;
+}
+
+void cTimeShiftStore::SetMemoryWindow(int seconds)
+{
+  MemoryWindow = (seconds > 0) ? seconds : 0;
+  DEBUGLOG("Timeshift memory window: %i seconds", MemoryWindow);
+}
+
+int cTimeShiftStore::GetMemoryWindow()
+{
+  return MemoryWindow;
+}
+
+void cTimeShiftStore::SetMemorySize(uint64_t bytes)
+{
+  MemorySize = bytes;
+  DEBUGLOG("Timeshift memory size: %llu bytes", (unsigned long long)MemorySize);
+}
+
+uint64_t cTimeShiftStore::Now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+
+  return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+uint8_t* cTimeShiftStore::AllocBlock()
+{
+  {
+    cMutexLock lock(&m_poolLock);
+
+    if(!m_blockPool.empty())
+    {
+      uint8_t* block = m_blockPool.back();
+      m_blockPool.pop_back();
+      return block;
+    }
+  }
+
+  uint8_t* block = NULL;
+
+  if(posix_memalign((void**)&block, Alignment, BlockSize) != 0)
+    return NULL;
+
+  return block;
+}
+
+void cTimeShiftStore::ReleaseBlock(uint8_t* block)
+{
+  if(block == NULL)
+    return;
+
+  cMutexLock lock(&m_poolLock);
+
+  // keep the blocks of one memory window for the next store
+  if(m_blockPool.size() < MemorySize / BlockSize)
+  {
+    m_blockPool.push_back(block);
+    return;
+  }
+
+  free(block);
+}
+
+cTimeShiftStore* cTimeShiftStore::Acquire(uint32_t channeluid, const cString& filename, uint64_t size)
+{
+  cMutexLock lock(&m_storesLock);
+
+  std::map<uint32_t, cTimeShiftStore*>::iterator i = m_stores.find(channeluid);
+
+  // channel is already buffered
+  if(i != m_stores.end())
+  {
+    i->second->m_refs++;
+    DEBUGLOG("Sharing timeshift buffer of channel %08x (%i clients)", channeluid, i->second->m_refs);
+    return i->second;
+  }
+
+  cTimeShiftStore* store = new cTimeShiftStore(filename, size);
+
+  if(!store->IsOpen())
+  {
+    delete store;
+    return NULL;
+  }
+
+  store->m_channeluid = channeluid;
+  store->m_refs = 1;
+
+  cTimeShiftSpace::Register(store);
+  store->Start();
+
+  m_stores[channeluid] = store;
+  return store;
+}
+
+void cTimeShiftStore::Release(cTimeShiftStore* store, const void* feeder)
+{
+  if(store == NULL)
+    return;
+
+  cMutexLock lock(&m_storesLock);
+
+  // let another client continue writing
+  __sync_bool_compare_and_swap(&store->m_feeder, feeder, (const void*)NULL);
+
+  if(--store->m_refs > 0)
+    return;
+
+  m_stores.erase(store->m_channeluid);
+  delete store;
+}
+
+bool cTimeShiftStore::IsFeeder(const void* feeder)
+{
+  // the packet is already written by another client (or the first one takes over)
+  return (m_feeder == feeder || __sync_bool_compare_and_swap(&m_feeder, (const void*)NULL, feeder));
+}
+
+bool cTimeShiftStore::Append(MsgPacket* p, const sStreamPacket* pkt, const void* feeder)
+{
+  if(!IsFeeder(feeder))
+  {
+    delete p;
+    return true;
+  }
+
+  sAppendItem item;
+  item.packet = p;
+  item.mark = NULL;
+  item.previous = false;
+  item.time = Now();
+  item.pts = (pkt != NULL) ? pkt->pts : DVD_NOPTS_VALUE;
+  item.content = (pkt != NULL) ? pkt->content : scNONE;
+  item.keyframe = (pkt != NULL && pkt->content == scVIDEO && pkt->frametype == PKT_I_FRAME);
+
+  m_appendSerial = (pkt != NULL) ? pkt->serial : 0;
+
+  // the writer can't keep up
+  if(!m_queue.Push(item))
+  {
+    m_dropped++;
+    delete p;
+    return false;
+  }
+
+  return true;
+}
+
+bool cTimeShiftStore::Mark(volatile uint64_t* position, const sStreamPacket* pkt)
+{
+  sAppendItem item;
+  memset(&item, 0, sizeof(item));
+  item.mark = position;
+
+  // all clients get the same packets on the same thread, but the feeder
+  // may have appended this one before
+  item.previous = (pkt != NULL && pkt->serial != 0 && pkt->serial == m_appendSerial);
+
+  return m_queue.Push(item);
+}
+
+void cTimeShiftStore::Spill()
+{
+  m_spill = 1;
+  m_queue.Wakeup();
+}
+
+void cTimeShiftStore::Action()
+{
+  while(Running())
+  {
+    sAppendItem item;
+
+    while(m_queue.Pop(item))
+    {
+      Write(item);
+      delete item.packet;
+    }
+
+    if(m_spill && m_fd == -1 && !m_spillFailed)
+      SpillNow();
+
+    if(m_shrink != 0)
+      ApplyLimit();
+
+    if(MemoryWindow > 0)
+      EvictOld();
+
+    if(m_fd != -1)
+      cTimeShiftSpace::Check();
+
+    // let the packets pile up for a while (no wakeup per packet)
+    m_queue.Sleep(WriteInterval);
+  }
+}
+
+void cTimeShiftStore::Write(const sAppendItem& item)
+{
+  // position requested by Mark()
+  if(item.packet == NULL)
+  {
+    *item.mark = item.previous ? m_lastStart : m_head;
+    __sync_synchronize();
+    return;
+  }
+
+  MsgPacket* p = item.packet;
+  uint32_t length = p->getPacketLength();
+  uint32_t offset = 0;
+
+  m_lastStart = m_head;
+
+  AddIndex(item, m_head);
+
+  // packets may span blocks
+  while(offset < length)
+  {
+    if(m_blockFill == 0)
+      StartBlock();
+
+    uint32_t slot = (m_blockStart / BlockSize) % m_ringSize;
+    uint32_t size = length - offset;
+
+    if(size > BlockSize - m_blockFill)
+      size = BlockSize - m_blockFill;
+
+    // out of memory, the packet is lost
+    if(m_ring[slot] == NULL)
+    {
+      m_dropped++;
+      return;
+    }
+
+    p->copyTo(m_ring[slot] + m_blockFill, offset, size);
+    m_ringTime[slot] = item.time;
+
+    m_blockFill += size;
+    offset += size;
+
+    // make the data readable
+    __sync_synchronize();
+    m_head = m_blockStart + m_blockFill;
+
+    if(m_blockFill == BlockSize)
+      CompleteBlock();
+  }
+}
+
+void cTimeShiftStore::StartBlock()
+{
+  // the ring is full
+  while(m_blockStart - m_memTail >= (uint64_t)m_ringSize * BlockSize)
+    EvictBlock();
+
+  uint32_t slot = (m_blockStart / BlockSize) % m_ringSize;
+
+  if(m_ring[slot] == NULL)
+  {
+    uint8_t* block = AllocBlock();
+
+    if(block != NULL)
+      __sync_add_and_fetch(&m_memBlocks, 1);
+
+    cMutexLock lock(&m_memLock);
+    m_ring[slot] = block;
+  }
+}
+
+void cTimeShiftStore::CompleteBlock()
+{
+  if(m_fd != -1)
+    WriteBlock(m_blockStart);
+
+  m_blockStart += BlockSize;
+  m_blockFill = 0;
+}
+
+void cTimeShiftStore::EvictBlock()
+{
+  uint64_t start = m_memTail;
+
+  // a reader still needs the block, keep it in the file
+  if(m_fd == -1 && !m_spillFailed && ReaderBehind(start + BlockSize))
+    SpillNow();
+
+  uint32_t slot = (start / BlockSize) % m_ringSize;
+  uint8_t* block = NULL;
+
+  {
+    cMutexLock lock(&m_memLock);
+
+    m_memTail = start + BlockSize;
+    __sync_synchronize();
+
+    block = m_ring[slot];
+    m_ring[slot] = NULL;
+  }
+
+  if(block != NULL)
+    __sync_sub_and_fetch(&m_memBlocks, 1);
+
+  ReleaseBlock(block);
+  UpdateTail();
+}
+
+void cTimeShiftStore::EvictOld()
+{
+  uint64_t limit = Now() - (uint64_t)MemoryWindow * 1000;
+
+  // never the block currently being filled
+  while(m_memTail < m_blockStart && m_ringTime[(m_memTail / BlockSize) % m_ringSize] < limit)
+    EvictBlock();
+}
+
+bool cTimeShiftStore::ReaderBehind(uint64_t position)
+{
+  cMutexLock lock(&m_memLock);
+
+  for(std::set<cTimeShiftReader*>::iterator i = m_readers.begin(); i != m_readers.end(); i++)
+  {
+    uint64_t p = (*i)->Position();
+
+    if(p >= m_memTail && p < position)
+      return true;
+  }
+
+  return false;
+}
+
+void cTimeShiftStore::AddReader(cTimeShiftReader* reader)
+{
+  cMutexLock lock(&m_memLock);
+  m_readers.insert(reader);
+}
+
+void cTimeShiftStore::RemoveReader(cTimeShiftReader* reader)
+{
+  cMutexLock lock(&m_memLock);
+  m_readers.erase(reader);
+}
+
+bool cTimeShiftStore::SpillNow()
+{
+  // the size of the file depends on the space left
+  uint64_t size = cTimeShiftSpace::Grant(this, m_capacity);
+
+  if(size == 0)
+  {
+    m_spillFailed = true;
+    return false;
+  }
+
+  int flags = O_CREAT | O_RDWR | O_TRUNC | O_CLOEXEC;
+  int fd = -1;
+
+  if(DirectIO)
+  {
+    fd = open(m_filename, flags | O_DIRECT, 0644);
+
+    // not supported by all filesystems (tmpfs, ...)
+    if(fd == -1 && errno == EINVAL)
+      INFOLOG("O_DIRECT not supported for %s", (const char*)m_filename);
+  }
+
+  if(fd == -1)
+    fd = open(m_filename, flags, 0644);
+
+  if(fd == -1)
+  {
+    ERRORLOG("Unable to create timeshift file %s (%s)", (const char*)m_filename, strerror(errno));
+    m_spillFailed = true;
+    return false;
+  }
+
+  m_capacity = size;
+
+  // reserve the whole ring, so appends never allocate (or fragment)
+  if(fallocate(fd, 0, 0, m_capacity) != 0)
+  {
+    DEBUGLOG("fallocate failed (%s), using a sparse file", strerror(errno));
+
+    if(ftruncate(fd, m_capacity) != 0)
+      ERRORLOG("Unable to resize timeshift file %s", (const char*)m_filename);
+  }
+
+  m_diskStart = m_memTail;
+  m_diskEnd = m_memTail;
+  m_limit = m_capacity;
+  __sync_synchronize();
+  m_fd = fd;
+
+  // the complete blocks of the memory window (the current one follows when it's full)
+  for(uint64_t start = m_memTail; start < m_blockStart; start += BlockSize)
+    WriteBlock(start);
+
+  INFOLOG("Timeshift buffer spilled to %s (%llu bytes)", (const char*)m_filename, (unsigned long long)m_capacity);
+  return true;
+}
+
+bool cTimeShiftStore::WriteBlock(uint64_t start)
+{
+  // this block replaces the oldest data in the file
+  m_diskEnd = start + BlockSize;
+  UpdateTail();
+
+  uint8_t* block = m_ring[(start / BlockSize) % m_ringSize];
+  off_t offset = start % m_capacity;
+  uint32_t done = 0;
+
+  // the block couldn't be allocated
+  if(block == NULL)
+    return false;
+
+  while(done < BlockSize)
+  {
+    ssize_t rc = pwrite(m_fd, block + done, BlockSize - done, offset + done);
+
+    if(rc == -1 && errno == EINTR)
+      continue;
+
+    if(rc <= 0)
+    {
+      ERRORLOG("Unable to write into timeshift file (%s)", strerror(errno));
+      return false;
+    }
+
+    done += rc;
+  }
+
+  // the file has been shrunk, release the block that dropped out
+  if(m_limit < m_capacity && m_diskEnd >= m_diskStart + m_limit + BlockSize)
+    PunchBlock(m_diskEnd - m_limit - BlockSize);
+
+  return true;
+}
+
+uint64_t cTimeShiftStore::DiskUsage() const
+{
+  if(m_fd == -1)
+    return 0;
+
+  uint64_t limit = m_shrink;
+
+  return (limit != 0 && limit < m_limit) ? limit : m_limit;
+}
+
+void cTimeShiftStore::Shrink(uint64_t bytes)
+{
+  bytes = (bytes / BlockSize) * BlockSize;
+
+  if(bytes < MinBlocks * BlockSize)
+    bytes = MinBlocks * BlockSize;
+
+  if(bytes >= DiskUsage())
+    return;
+
+  m_shrink = bytes;
+  m_queue.Wakeup();
+}
+
+void cTimeShiftStore::ApplyLimit()
+{
+  uint64_t limit = m_shrink;
+  uint64_t old = m_limit;
+
+  m_shrink = 0;
+
+  if(m_fd == -1 || limit >= old)
+    return;
+
+  m_limit = limit;
+  UpdateTail();
+
+  // release the blocks between the old and the new limit
+  uint64_t start = (m_diskEnd > old) ? m_diskEnd - old : 0;
+  uint64_t end = (m_diskEnd > limit) ? m_diskEnd - limit : 0;
+
+  if(start < m_diskStart)
+    start = m_diskStart;
+
+  for(; start < end; start += BlockSize)
+    PunchBlock(start);
+
+  DEBUGLOG("Timeshift file %s limited to %llu bytes", (const char*)m_filename, (unsigned long long)m_limit);
+}
+
+void cTimeShiftStore::PunchBlock(uint64_t start)
+{
+  // not supported by all filesystems, the space is kept then
+  fallocate(m_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, start % m_capacity, BlockSize);
+}
+
+void cTimeShiftStore::UpdateTail()
+{
+  uint64_t tail = m_memTail;
+
+  // older data may still be in the file
+  if(m_fd != -1)
+  {
+    uint64_t disk = m_diskStart;
+
+    if(m_diskEnd > m_limit && m_diskEnd - m_limit > disk)
+      disk = m_diskEnd - m_limit;
+
+    if(disk < tail)
+      tail = disk;
+  }
+
+  if(tail <= m_tail)
+    return;
+
+  m_tail = tail;
+  __sync_synchronize();
+
+  // forget the overwritten packets
+  cMutexLock lock(&m_indexLock);
+
+  while(!m_index.empty() && m_index.front().position < m_tail)
+    m_index.pop_front();
+}
+
+bool cTimeShiftStore::Read(uint8_t* buffer, uint64_t position, uint32_t length)
+{
+  if(position < m_tail)
+    return false;
+
+  uint64_t p = position;
+  uint32_t done = 0;
+
+  while(done < length)
+  {
+    uint32_t size = length - done;
+
+    // recent data is in memory
+    {
+      cMutexLock lock(&m_memLock);
+
+      if(p >= m_memTail)
+      {
+        uint32_t offset = p % BlockSize;
+
+        if(size > BlockSize - offset)
+          size = BlockSize - offset;
+
+        uint8_t* block = m_ring[(p / BlockSize) % m_ringSize];
+
+        // (aligned) reads may go a bit beyond the written data
+        if(block != NULL)
+          memcpy(buffer + done, block + offset, size);
+        else
+          memset(buffer + done, 0, size);
+
+        done += size;
+        p += size;
+        continue;
+      }
+
+      // read the file up to the memory window
+      if(p + size > m_memTail)
+        size = m_memTail - p;
+    }
+
+    if(m_fd == -1)
+      return false;
+
+    uint64_t offset = p % m_capacity;
+
+    // the ring wraps around
+    if(offset + size > m_capacity)
+      size = m_capacity - offset;
+
+    ssize_t rc = pread(m_fd, buffer + done, size, offset);
+
+    if(rc == -1 && errno == EINTR)
+      continue;
+
+    if(rc <= 0)
+      return false;
+
+    done += rc;
+    p += rc;
+  }
+
+  // the writer may have overwritten the data in the meantime
+  __sync_synchronize();
+  return (position >= m_tail);
+}
+
+void cTimeShiftStore::AddIndex(const sAppendItem& item, uint64_t position)
+{
+  // control packets can't be seeked to
+  if(item.content == scNONE || item.pts == DVD_NOPTS_VALUE)
+    return;
+
+  sTimeShiftPosition entry;
+  entry.position = position;
+  entry.time = item.time;
+  entry.pts = item.pts;
+  entry.keyframe = item.keyframe;
+
+  cMutexLock lock(&m_indexLock);
+
+  // audio comes along with every video frame, a few entries are enough
+  if(item.keyframe || m_index.empty() || item.time >= m_index.back().time + IndexInterval)
+    m_index.push_back(entry);
+
+  m_newest = entry;
+}
+
+int cTimeShiftStore::FindIndex(uint64_t position)
+{
+  // binary search for the last entry at or before the position
+  int low = 0;
+  int high = (int)m_index.size() - 1;
+  int found = -1;
+
+  while(low <= high)
+  {
+    int mid = (low + high) / 2;
+
+    if(m_index[mid].position <= position)
+    {
+      found = mid;
+      low = mid + 1;
+    }
+    else
+      high = mid - 1;
+  }
+
+  return found;
+}
+
+bool cTimeShiftStore::FindTime(uint64_t time, sTimeShiftPosition& entry)
+{
+  cMutexLock lock(&m_indexLock);
+
+  if(m_index.empty())
+    return false;
+
+  // last entry at or before the time
+  int low = 0;
+  int high = (int)m_index.size() - 1;
+  int found = 0;
+
+  while(low <= high)
+  {
+    int mid = (low + high) / 2;
+
+    if(m_index[mid].time <= time)
+    {
+      found = mid;
+      low = mid + 1;
+    }
+    else
+      high = mid - 1;
+  }
+
+  // prefer the keyframe in front of it, then the next one
+  for(int i = found; i >= 0; i--)
+  {
+    if(m_index[i].keyframe)
+    {
+      entry = m_index[i];
+      return true;
+    }
+  }
+
+  for(int i = found + 1; i < (int)m_index.size(); i++)
+  {
+    if(m_index[i].keyframe)
+    {
+      entry = m_index[i];
+      return true;
+    }
+  }
+
+  // radio channels don't have keyframes, every audio packet is a sync point
+  entry = m_index[found];
+  return true;
+}
+
+bool cTimeShiftStore::FindPosition(uint64_t position, sTimeShiftPosition& entry)
+{
+  cMutexLock lock(&m_indexLock);
+
+  if(m_index.empty())
+    return false;
+
+  int i = FindIndex(position);
+  entry = m_index[(i == -1) ? 0 : i];
+
+  // the newest packet isn't necessarily indexed
+  if(m_newest.position <= position && m_newest.position > entry.position)
+    entry = m_newest;
+
+  return true;
+}
+
+bool cTimeShiftStore::FindKeyFrame(uint64_t position, bool forward, sTimeShiftPosition& entry)
+{
+  cMutexLock lock(&m_indexLock);
+
+  int i = FindIndex(position);
+
+  if(forward)
+  {
+    for(i++; i < (int)m_index.size(); i++)
+    {
+      if(m_index[i].keyframe && m_index[i].position > position)
+      {
+        entry = m_index[i];
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  for(; i >= 0; i--)
+  {
+    if(m_index[i].keyframe && m_index[i].position < position)
+    {
+      entry = m_index[i];
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool cTimeShiftStore::GetRange(sTimeShiftPosition& first, sTimeShiftPosition& last)
+{
+  cMutexLock lock(&m_indexLock);
+
+  if(m_index.empty())
+    return false;
+
+  first = m_index.front();
+  last = m_newest;
+
+  return true;
+}
+
+void cTimeShiftStore::Prefetch(uint64_t position, uint32_t length)
+{
+  // only the file needs to be read
+  if(DirectIO || m_fd == -1 || position >= m_memTail)
+    return;
+
+  uint64_t offset = position % m_capacity;
+
+  if(offset + length > m_capacity)
+    length = m_capacity - offset;
+
+  posix_fadvise(m_fd, offset, length, POSIX_FADV_WILLNEED);
+}
+
+
+cTimeShiftReader::cTimeShiftReader(cTimeShiftStore* store, uint64_t position) : m_store(store), m_position(position), m_packetPosition(position), m_sync(false), m_buffer(NULL), m_bufferSize(0), m_bufferStart(0), m_bufferLength(0)
+{
+  m_store->AddReader(this);
+}
+
+cTimeShiftReader::~cTimeShiftReader()
+{
+  m_store->RemoveReader(this);
+  free(m_buffer);
+}
+
+void cTimeShiftReader::Seek(uint64_t position, bool sync)
+{
+  m_position = position;
+  m_packetPosition = position;
+  m_sync = sync;
+}
+
+bool cTimeShiftReader::Fill(uint32_t length)
+{
+  uint64_t head = m_store->Head();
+
+  if(m_position + length > head)
+    return false;
+
+  // already buffered
+  if(m_position >= m_bufferStart && m_position + length <= m_bufferStart + m_bufferLength)
+    return true;
+
+  // read a big aligned chunk, so several readers on one disk don't seek all the time
+  uint64_t start = m_position & ~(uint64_t)(cTimeShiftStore::Alignment - 1);
+  uint32_t chunk = (length + cTimeShiftStore::Alignment > ReadAheadSize) ? length + cTimeShiftStore::Alignment : ReadAheadSize;
+  uint64_t end = head;
+
+  if(end > start + chunk)
+    end = start + chunk;
+
+  uint32_t size = ((end - start) + cTimeShiftStore::Alignment - 1) & ~(cTimeShiftStore::Alignment - 1);
+
+  if(size > m_bufferSize)
+  {
+    free(m_buffer);
+    m_buffer = NULL;
+    m_bufferSize = 0;
+    m_bufferLength = 0;
+
+    if(posix_memalign((void**)&m_buffer, cTimeShiftStore::Alignment, size) != 0)
+    {
+      m_buffer = NULL;
+      return false;
+    }
+
+    m_bufferSize = size;
+  }
+
+  if(!m_store->Read(m_buffer, start, size))
+  {
+    m_bufferLength = 0;
+    return false;
+  }
+
+  m_bufferStart = start;
+  m_bufferLength = end - start;
+
+  // let the kernel fetch the next chunk in the background
+  m_store->Prefetch(end, ReadAheadSize);
+
+  return true;
+}
+
+bool cTimeShiftReader::Sync()
+{
+  while(Fill(MsgPacket::HeaderLength))
+  {
+    const uint8_t* data = m_buffer + (m_position - m_bufferStart);
+    uint32_t available = m_bufferStart + m_bufferLength - m_position;
+    uint32_t offset = MsgReader::findSync(data, available);
+
+    // no complete header in the buffer, continue behind it
+    if(offset + MsgPacket::HeaderLength > available)
+    {
+      if(offset == available)
+        offset = available - 3;
+
+      // nothing more to read yet
+      if(offset == 0)
+        return false;
+
+      m_position += offset;
+      continue;
+    }
+
+    uint32_t payloadlength = 0;
+
+    if(MsgReader::checkHeader(data + offset, payloadlength))
+    {
+      m_position += offset;
+      m_sync = false;
+      return true;
+    }
+
+    m_position += offset + 1;
+  }
+
+  return false;
+}
+
+MsgPacket* cTimeShiftReader::Read()
+{
+  // overrun: continue with the oldest packet still stored
+  if(m_position < m_store->Tail())
+  {
+    m_position = m_store->Tail();
+    m_sync = true;
+  }
+
+  if(m_sync && !Sync())
+    return NULL;
+
+  if(!Fill(MsgPacket::HeaderLength))
+    return NULL;
+
+  uint32_t payloadlength = 0;
+
+  if(!MsgReader::checkHeader(m_buffer + (m_position - m_bufferStart), payloadlength))
+  {
+    m_sync = true;
+    m_position++;
+    return NULL;
+  }
+
+  if(!Fill(MsgPacket::HeaderLength + payloadlength))
+    return NULL;
+
+  MsgPacket* p = MsgReader::decode(m_buffer + (m_position - m_bufferStart), payloadlength);
+  m_packetPosition = m_position;
+  m_position += MsgPacket::HeaderLength + payloadlength;
+
+  return p;
+}
@@ -0,0 +1,357 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef XVDR_TIMESHIFTSTORE_H
+#define XVDR_TIMESHIFTSTORE_H
+
+#include <stdint.h>
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+#include <vdr/thread.h>
+#include <vdr/tools.h>
+
+#include "tools/spscqueue.h"
+
+class MsgPacket;
+struct sStreamPacket;
+
+// index entry of a stored packet
+
+struct sTimeShiftPosition
+{
+  uint64_t position;   // logical file position of the packet
+  uint64_t time;       // wall clock when it was added (ms since the epoch)
+  int64_t  pts;
+  bool     keyframe;   // decoding can start here
+};
+
+// Rolling timeshift buffer of a channel. The demuxer hands packets to
+// Append() without ever touching the disk, a writer thread collects them
+// into aligned blocks.
+// The newest blocks are kept in memory (the memory window). The blocks are
+// only written to a preallocated ring file when a reader would fall out of
+// the window (the client paused for too long) or on request (Spill()).
+// Positions are logical byte offsets (total bytes written so far), the
+// file holds the last Capacity() bytes (or less, see Shrink()).
+// Stores are shared by all clients watching the same channel. Only one
+// client (the feeder) writes into the store, the others just read.
+
+class cTimeShiftReader;
+
+class cTimeShiftStore : public cThread
+{
+public:
+
+  cTimeShiftStore(const cString& filename, uint64_t size);
+
+  virtual ~cTimeShiftStore();
+
+  bool IsOpen() const { return m_ring != NULL; }
+
+  // get the store of a channel (created if it doesn't exist)
+  static cTimeShiftStore* Acquire(uint32_t channeluid, const cString& filename, uint64_t size);
+
+  // drop a reference (the store is deleted with the last one)
+  static void Release(cTimeShiftStore* store, const void* feeder);
+
+  // demuxer thread: check if the packets of this client are stored
+  // (the first client calling this after the feeder left takes over)
+  bool IsFeeder(const void* feeder);
+
+  // demuxer thread: queue a packet (takes ownership, never blocks).
+  // packets of other feeders than the current one are dropped.
+  bool Append(MsgPacket* p, const sStreamPacket* pkt, const void* feeder);
+
+  // demuxer thread (any client): the writer sets "position" to the position of "pkt".
+  // if the feeder already appended "pkt", that's the packet written last, otherwise
+  // the next appended one.
+  bool Mark(volatile uint64_t* position, const sStreamPacket* pkt);
+
+  // write the memory window into the file and keep writing (any thread)
+  void Spill();
+
+  bool IsSpilled() const { return m_fd != -1; }
+
+  // oldest byte still stored
+  uint64_t Tail() const { return m_tail; }
+
+  // end of the data that can be read
+  uint64_t Head() const { return m_head; }
+
+  // size of the ring file
+  uint64_t Capacity() const { return m_capacity; }
+
+  // bytes of the file in use
+  uint64_t DiskUsage() const;
+
+  // bytes of the memory window in use
+  uint64_t MemoryUsage() const { return (uint64_t)m_memBlocks * BlockSize; }
+
+  // keep only the newest "bytes" of the file, the rest is released (any thread)
+  void Shrink(uint64_t bytes);
+
+  uint32_t ChannelUID() const { return m_channeluid; }
+
+  int Clients() const { return m_refs; }
+
+  // read stored data, returns false if (a part of) it has been overwritten
+  bool Read(uint8_t* buffer, uint64_t position, uint32_t length);
+
+  // readahead hint for the kernel
+  void Prefetch(uint64_t position, uint32_t length);
+
+  // sync point at or before the given time (the oldest one if the time isn't stored anymore)
+  bool FindTime(uint64_t time, sTimeShiftPosition& entry);
+
+  // last entry at or before the given position
+  bool FindPosition(uint64_t position, sTimeShiftPosition& entry);
+
+  // keyframe behind (or in front of) the given position
+  bool FindKeyFrame(uint64_t position, bool forward, sTimeShiftPosition& entry);
+
+  // oldest and newest stored packet
+  bool GetRange(sTimeShiftPosition& first, sTimeShiftPosition& last);
+
+  static void SetDirectIO(bool on);
+
+  // length of the memory window in seconds (0: buffer only while paused)
+  static void SetMemoryWindow(int seconds);
+
+  static int GetMemoryWindow();
+
+  // maximum memory per channel
+  static void SetMemorySize(uint64_t bytes);
+
+  static uint64_t Now();
+
+  enum
+  {
+    BlockSize = 256 * 1024,  // unit of writes
+    Alignment = 4096,        // O_DIRECT alignment of offsets, sizes and buffers
+    QueueSize = 1024,        // packets waiting for the writer thread
+    WriteInterval = 20,      // ms between writer runs
+    IndexInterval = 1000,    // ms between index entries without a keyframe
+    MinBlocks = 4            // memory blocks of a store without memory window
+  };
+
+protected:
+
+  void Action();
+
+private:
+
+  friend class cTimeShiftReader;
+
+  struct sAppendItem
+  {
+    MsgPacket* packet;
+    volatile uint64_t* mark;
+    bool       previous;  // mark the packet written last
+    uint64_t   time;
+    int64_t    pts;
+    uint8_t    content;
+    bool       keyframe;
+  };
+
+  void Write(const sAppendItem& item);
+
+  void AddIndex(const sAppendItem& item, uint64_t position);
+
+  void StartBlock();
+
+  void CompleteBlock();
+
+  // drop the oldest memory block
+  void EvictBlock();
+
+  // drop memory blocks older than the memory window
+  void EvictOld();
+
+  bool ReaderBehind(uint64_t position);
+
+  bool SpillNow();
+
+  bool WriteBlock(uint64_t start);
+
+  // apply a limit requested by Shrink()
+  void ApplyLimit();
+
+  // give the disk space of a block back to the filesystem
+  void PunchBlock(uint64_t start);
+
+  void UpdateTail();
+
+  int FindIndex(uint64_t position);
+
+  void AddReader(cTimeShiftReader* reader);
+
+  void RemoveReader(cTimeShiftReader* reader);
+
+  static uint8_t* AllocBlock();
+
+  static void ReleaseBlock(uint8_t* block);
+
+  cString m_filename;
+
+  volatile int m_fd;
+
+  uint64_t m_capacity;
+
+  // bytes of the file kept (the space behind is released)
+  volatile uint64_t m_limit;
+
+  // limit requested by Shrink() (0: none)
+  volatile uint64_t m_shrink;
+
+  volatile int m_memBlocks;
+
+  // memory window: block n is held in m_ring[n % m_ringSize]
+  uint8_t** m_ring;
+
+  // time of the newest packet in each block
+  uint64_t* m_ringTime;
+
+  uint32_t m_ringSize;
+
+  // block currently being filled
+  uint64_t m_blockStart;
+
+  uint32_t m_blockFill;
+
+  // oldest byte in memory
+  volatile uint64_t m_memTail;
+
+  // part of the stream written into the file
+  uint64_t m_diskStart;
+
+  uint64_t m_diskEnd;
+
+  volatile uint64_t m_tail;
+
+  volatile uint64_t m_head;
+
+  volatile int m_spill;
+
+  bool m_spillFailed;
+
+  cSPSCQueue<sAppendItem> m_queue;
+
+  uint64_t m_dropped;
+
+  // memory blocks and readers
+  cMutex m_memLock;
+
+  std::set<cTimeShiftReader*> m_readers;
+
+  // sync points, ordered by position (and time)
+  cMutex m_indexLock;
+
+  std::deque<sTimeShiftPosition> m_index;
+
+  // newest packet with a pts
+  sTimeShiftPosition m_newest;
+
+  uint32_t m_channeluid;
+
+  // clients using the store (protected by m_storesLock)
+  int m_refs;
+
+  // the client writing into the store
+  const void* volatile m_feeder;
+
+  // serial of the packet appended last (demuxer thread)
+  uint32_t m_appendSerial;
+
+  // position of the packet written last (writer thread)
+  uint64_t m_lastStart;
+
+  static bool DirectIO;
+
+  static int MemoryWindow;
+
+  static uint64_t MemorySize;
+
+  static std::map<uint32_t, cTimeShiftStore*> m_stores;
+
+  static cMutex m_storesLock;
+
+  // free memory blocks
+  static std::vector<uint8_t*> m_blockPool;
+
+  static cMutex m_poolLock;
+};
+
+// Sequential packet reader with readahead, one per client.
+
+class cTimeShiftReader
+{
+public:
+
+  cTimeShiftReader(cTimeShiftStore* store, uint64_t position);
+
+  virtual ~cTimeShiftReader();
+
+  // next packet or NULL if there is none (yet)
+  MsgPacket* Read();
+
+  uint64_t Position() const { return m_position; }
+
+  // start of the packet returned by the last Read()
+  uint64_t PacketPosition() const { return m_packetPosition; }
+
+  // jump to a packet start (or search the next one if sync is set)
+  void Seek(uint64_t position, bool sync = false);
+
+  enum
+  {
+    ReadAheadSize = 1024 * 1024
+  };
+
+private:
+
+  bool Fill(uint32_t length);
+
+  bool Sync();
+
+  cTimeShiftStore* m_store;
+
+  volatile uint64_t m_position;
+
+  uint64_t m_packetPosition;
+
+  // search the next packet start (after an overrun)
+  bool m_sync;
+
+  uint8_t* m_buffer;
+
+  uint32_t m_bufferSize;
+
+  uint64_t m_bufferStart;
+
+  uint32_t m_bufferLength;
+};
+
+#endif // XVDR_TIMESHIFTSTORE_H
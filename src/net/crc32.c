@@ -0,0 +1,281 @@
+#include <string.h>
+#include <pthread.h>
+#include <endian.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_CRC32_PCLMUL
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#include "crc32.h"
+
+// slicing tables, crc32_tab[0] is the classic byte-at-a-time table
+static uint32_t crc32_tab[16][256];
+
+static pthread_once_t crc32_once = PTHREAD_ONCE_INIT;
+
+static crc32_func crc32_active = NULL;
+static const char* crc32_active_name = NULL;
+
+static void crc32_init_tables() {
+	for(uint32_t i = 0; i < 256; i++) {
+		uint32_t c = i;
+
+		for(int k = 0; k < 8; k++) {
+			c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+		}
+
+		crc32_tab[0][i] = c;
+	}
+
+	for(uint32_t i = 0; i < 256; i++) {
+		for(int t = 1; t < 16; t++) {
+			uint32_t c = crc32_tab[t - 1][i];
+			crc32_tab[t][i] = crc32_tab[0][c & 0xFF] ^ (c >> 8);
+		}
+	}
+}
+
+static uint32_t crc32_bytewise(uint32_t crc, const uint8_t* p, size_t size) {
+	while(size--) {
+		crc = crc32_tab[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+	}
+
+	return crc;
+}
+
+static inline uint32_t crc32_load32(const uint8_t* p) {
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return le32toh(v);
+}
+
+static uint32_t crc32_slice8(uint32_t crc, const uint8_t* p, size_t size) {
+	while(size >= 8) {
+		uint32_t one = crc32_load32(p) ^ crc;
+		uint32_t two = crc32_load32(p + 4);
+
+		crc = crc32_tab[7][one & 0xFF] ^
+		      crc32_tab[6][(one >> 8) & 0xFF] ^
+		      crc32_tab[5][(one >> 16) & 0xFF] ^
+		      crc32_tab[4][one >> 24] ^
+		      crc32_tab[3][two & 0xFF] ^
+		      crc32_tab[2][(two >> 8) & 0xFF] ^
+		      crc32_tab[1][(two >> 16) & 0xFF] ^
+		      crc32_tab[0][two >> 24];
+
+		p += 8;
+		size -= 8;
+	}
+
+	return crc32_bytewise(crc, p, size);
+}
+
+static uint32_t crc32_slice16(uint32_t crc, const uint8_t* p, size_t size) {
+	while(size >= 16) {
+		uint32_t one = crc32_load32(p) ^ crc;
+		uint32_t two = crc32_load32(p + 4);
+		uint32_t three = crc32_load32(p + 8);
+		uint32_t four = crc32_load32(p + 12);
+
+		crc = crc32_tab[15][one & 0xFF] ^
+		      crc32_tab[14][(one >> 8) & 0xFF] ^
+		      crc32_tab[13][(one >> 16) & 0xFF] ^
+		      crc32_tab[12][one >> 24] ^
+		      crc32_tab[11][two & 0xFF] ^
+		      crc32_tab[10][(two >> 8) & 0xFF] ^
+		      crc32_tab[9][(two >> 16) & 0xFF] ^
+		      crc32_tab[8][two >> 24] ^
+		      crc32_tab[7][three & 0xFF] ^
+		      crc32_tab[6][(three >> 8) & 0xFF] ^
+		      crc32_tab[5][(three >> 16) & 0xFF] ^
+		      crc32_tab[4][three >> 24] ^
+		      crc32_tab[3][four & 0xFF] ^
+		      crc32_tab[2][(four >> 8) & 0xFF] ^
+		      crc32_tab[1][(four >> 16) & 0xFF] ^
+		      crc32_tab[0][four >> 24];
+
+		p += 16;
+		size -= 16;
+	}
+
+	return crc32_slice8(crc, p, size);
+}
+
+static bool crc32_always() {
+	return true;
+}
+
+#ifdef HAVE_CRC32_PCLMUL
+
+// The SSE4.2 crc32 instruction implements CRC32C (Castagnoli), which differs from
+// the IEEE polynomial used by the protocol. So we use carry-less multiplication
+// to fold 64 byte blocks instead (Intel: "Fast CRC Computation for Generic
+// Polynomials Using PCLMULQDQ Instruction").
+
+static bool crc32_pclmul_supported() {
+	unsigned int eax, ebx, ecx, edx;
+
+	if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+		return false;
+	}
+
+	return (ecx & bit_PCLMUL) && (ecx & bit_SSE4_1);
+}
+
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t crc32_fold(uint32_t crc, const uint8_t* p, size_t size) {
+	// bit-reflected folding constants and barrett reduction values
+	static const uint64_t __attribute__((aligned(16))) k1k2[] = { 0x0154442bd4ULL, 0x01c6e41596ULL };
+	static const uint64_t __attribute__((aligned(16))) k3k4[] = { 0x01751997d0ULL, 0x00ccaa009eULL };
+	static const uint64_t __attribute__((aligned(16))) k5k0[] = { 0x0163cd6124ULL, 0x0000000000ULL };
+	static const uint64_t __attribute__((aligned(16))) poly[] = { 0x01db710641ULL, 0x01f7011641ULL };
+
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+	// load the first block of 64 bytes
+	x1 = _mm_loadu_si128((const __m128i*)(p + 0x00));
+	x2 = _mm_loadu_si128((const __m128i*)(p + 0x10));
+	x3 = _mm_loadu_si128((const __m128i*)(p + 0x20));
+	x4 = _mm_loadu_si128((const __m128i*)(p + 0x30));
+
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+	x0 = _mm_load_si128((const __m128i*)k1k2);
+
+	p += 64;
+	size -= 64;
+
+	// fold 4 x 128 bits in parallel
+	while(size >= 64) {
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+		x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+		x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+		y5 = _mm_loadu_si128((const __m128i*)(p + 0x00));
+		y6 = _mm_loadu_si128((const __m128i*)(p + 0x10));
+		y7 = _mm_loadu_si128((const __m128i*)(p + 0x20));
+		y8 = _mm_loadu_si128((const __m128i*)(p + 0x30));
+
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+
+		p += 64;
+		size -= 64;
+	}
+
+	// fold into 128 bits
+	x0 = _mm_load_si128((const __m128i*)k3k4);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+	// single fold blocks of 16 bytes
+	while(size >= 16) {
+		x2 = _mm_loadu_si128((const __m128i*)p);
+
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+		p += 16;
+		size -= 16;
+	}
+
+	// fold 128 bits to 64 bits
+	x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+	x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+	x1 = _mm_srli_si128(x1, 8);
+	x1 = _mm_xor_si128(x1, x2);
+
+	x0 = _mm_loadl_epi64((const __m128i*)k5k0);
+
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, x3);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	// barrett reduction to 32 bits
+	x0 = _mm_load_si128((const __m128i*)poly);
+
+	x2 = _mm_and_si128(x1, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+	x2 = _mm_and_si128(x2, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+
+static uint32_t crc32_pclmul(uint32_t crc, const uint8_t* p, size_t size) {
+	// folding needs at least 64 bytes, packet headers are handled by the tables
+	if(size < 64) {
+		return crc32_slice8(crc, p, size);
+	}
+
+	size_t folded = size & ~(size_t)15;
+
+	crc = crc32_fold(crc, p, folded);
+	return crc32_slice8(crc, p + folded, size - folded);
+}
+
+#endif
+
+static const crc32_engine engines[] = {
+#ifdef HAVE_CRC32_PCLMUL
+	{ "pclmul", crc32_pclmul, crc32_pclmul_supported },
+#endif
+	{ "slice16", crc32_slice16, crc32_always },
+	{ "slice8", crc32_slice8, crc32_always },
+	{ "table", crc32_bytewise, crc32_always },
+	{ NULL, NULL, NULL }
+};
+
+static void crc32_init() {
+	crc32_init_tables();
+
+	// engines are ordered by preference
+	for(const crc32_engine* e = engines; e->name != NULL; e++) {
+		if(e->supported()) {
+			crc32_active = e->update;
+			crc32_active_name = e->name;
+			break;
+		}
+	}
+}
+
+uint32_t crc32_compute(const uint8_t* buf, size_t size) {
+	return crc32_update(0, buf, size);
+}
+
+uint32_t crc32_update(uint32_t crc, const uint8_t* buf, size_t size) {
+	pthread_once(&crc32_once, crc32_init);
+	return crc32_active(crc ^ 0xFFFFFFFF, buf, size) ^ 0xFFFFFFFF;
+}
+
+const char* crc32_engine_name() {
+	pthread_once(&crc32_once, crc32_init);
+	return crc32_active_name;
+}
+
+const crc32_engine* crc32_engines() {
+	pthread_once(&crc32_once, crc32_init);
+	return engines;
+}
@@ -0,0 +1,70 @@
+/** \file crc32.h
+	Header file for the CRC32 engine.
+	This include file defines the CRC32 functions used for packet checksums and hashes
+*/
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+	CRC32 engine function.
+	Updates a raw (non-inverted) CRC32 register with the given data.
+
+	@param	crc		raw crc register
+	@param	buf		pointer to data array
+	@param	size	size of array in bytes
+	@return updated raw crc register
+*/
+typedef uint32_t (*crc32_func)(uint32_t crc, const uint8_t* buf, size_t size);
+
+/**
+	@short CRC32 engine descriptor
+
+	All engines compute the IEEE 802.3 CRC32 (polynomial 0xEDB88320, reflected),
+	the same checksum as zlib's crc32(). They only differ in speed.
+*/
+struct crc32_engine {
+	const char* name;			/*!< name of the engine */
+	crc32_func update;			/*!< engine function */
+	bool (*supported)();		/*!< returns true if the engine can run on this CPU */
+};
+
+/**
+	Compute a CRC32 checksum.
+	Uses the fastest engine available on the running CPU.
+
+	@param	buf		pointer to data array
+	@param	size	size of array in bytes
+	@return 32bit crc
+*/
+uint32_t crc32_compute(const uint8_t* buf, size_t size);
+
+/**
+	Continue a CRC32 checksum.
+	Works like zlib's crc32(). Start with a crc of 0.
+
+	@param	crc		crc of the preceding data
+	@param	buf		pointer to data array
+	@param	size	size of array in bytes
+	@return 32bit crc
+*/
+uint32_t crc32_update(uint32_t crc, const uint8_t* buf, size_t size);
+
+/**
+	Get the active engine.
+
+	@return name of the engine selected at runtime
+*/
+const char* crc32_engine_name();
+
+/**
+	Get all engines.
+
+	@return list of engines, terminated by an entry with a NULL name
+*/
+const crc32_engine* crc32_engines();
+
+#endif // CRC32_H
@@ -0,0 +1,60 @@
+#include <stdlib.h>
+
+#include "msgbuffer.h"
+
+MsgBuffer::MsgBuffer() : m_data(NULL), m_size(0), m_refcount(1) {
+}
+
+MsgBuffer::~MsgBuffer() {
+	free(m_data);
+}
+
+MsgBuffer* MsgBuffer::create(uint32_t size) {
+	MsgBuffer* buffer = new MsgBuffer;
+
+	if(!buffer->resize(size)) {
+		delete buffer;
+		return NULL;
+	}
+
+	return buffer;
+}
+
+void MsgBuffer::ref() {
+	__sync_add_and_fetch(&m_refcount, 1);
+}
+
+void MsgBuffer::unref() {
+	if(__sync_sub_and_fetch(&m_refcount, 1) == 0) {
+		delete this;
+	}
+}
+
+bool MsgBuffer::shared() {
+	return (__sync_fetch_and_add(&m_refcount, 0) > 1);
+}
+
+bool MsgBuffer::resize(uint32_t size) {
+	if(shared()) {
+		return false;
+	}
+
+	uint8_t* data = (uint8_t*)realloc(m_data, size);
+
+	if(data == NULL) {
+		return false;
+	}
+
+	m_data = data;
+	m_size = size;
+
+	return true;
+}
+
+uint8_t* MsgBuffer::data() {
+	return m_data;
+}
+
+uint32_t MsgBuffer::size() {
+	return m_size;
+}
@@ -0,0 +1,83 @@
+/** \file msgbuffer.h
+	Header file for the MsgBuffer class.
+	This include file defines the MsgBuffer class
+*/
+
+#ifndef MSGBUFFER_H
+#define MSGBUFFER_H
+
+#include <stdint.h>
+
+/**
+	@short Shared buffer class
+
+	A reference counted memory block. A MsgBuffer can be attached to the payload
+	of one or more MsgPacket objects without copying its data. The buffer is released
+	when the last reference is dropped.
+*/
+
+class MsgBuffer {
+public:
+
+	/**
+	Create a buffer.
+	Allocates a new buffer with a reference count of 1.
+
+	@param	size	size of the buffer in bytes
+	@return pointer to new buffer or NULL if memory allocation failed
+	*/
+	static MsgBuffer* create(uint32_t size);
+
+	/**
+	Add a reference.
+	*/
+	void ref();
+
+	/**
+	Drop a reference.
+	The buffer is deleted when the last reference has been dropped.
+	*/
+	void unref();
+
+	/**
+	Check for other references.
+
+	@return true if more than one reference is held
+	*/
+	bool shared();
+
+	/**
+	Resize buffer.
+	Changes the size of the buffer. Only allowed as long as the buffer is not shared.
+
+	@param	size	new size of the buffer in bytes
+	@return true on success
+	*/
+	bool resize(uint32_t size);
+
+	/**
+	Get pointer to buffer data.
+
+	@return pointer to the buffer memory
+	*/
+	uint8_t* data();
+
+	/**
+	Get buffer size.
+
+	@return size of the buffer in bytes
+	*/
+	uint32_t size();
+
+private:
+
+	MsgBuffer();
+
+	~MsgBuffer();
+
+	uint8_t* m_data;
+	uint32_t m_size;
+	volatile int m_refcount;
+};
+
+#endif // MSGBUFFER_H
@@ -0,0 +1,211 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "os-config.h"
+#include "msgpacket.h"
+#include "msgcompressor.h"
+
+MsgCompressor::MsgCompressor(int level) : m_level(level), m_deflate(NULL), m_inflate(NULL), m_failed(false) {
+}
+
+MsgCompressor::~MsgCompressor() {
+#ifdef HAVE_ZLIB
+
+	if(m_deflate != NULL) {
+		deflateEnd((z_stream*)m_deflate);
+		free(m_deflate);
+	}
+
+	if(m_inflate != NULL) {
+		inflateEnd((z_stream*)m_inflate);
+		free(m_inflate);
+	}
+
+#endif
+}
+
+void MsgCompressor::setLevel(int level) {
+	if(m_deflate == NULL) {
+		m_level = level;
+	}
+}
+
+bool MsgCompressor::compress(MsgPacket* p) {
+#ifndef HAVE_ZLIB
+	return false;
+#else
+
+	if(m_failed || m_level <= 0 || m_level > 9 || p->m_freezed) {
+		return false;
+	}
+
+	uint32_t uncompressedsize = p->getPayloadLength();
+
+	if(uncompressedsize == 0) {
+		return true;
+	}
+
+	if(uncompressedsize > MsgPacket::UncompressedLengthMask) {
+		return false;
+	}
+
+	if(m_deflate == NULL) {
+		z_stream* strm = (z_stream*)calloc(1, sizeof(z_stream));
+
+		if(strm == NULL) {
+			return false;
+		}
+
+		if(deflateInit(strm, m_level) != Z_OK) {
+			free(strm);
+			return false;
+		}
+
+		m_deflate = strm;
+	}
+
+	z_stream* strm = (z_stream*)m_deflate;
+
+	// room for the sync flush marker and block headers
+	uint32_t size = deflateBound(strm, uncompressedsize) + 16;
+	uint8_t* compressed = (uint8_t*)malloc(size);
+
+	if(compressed == NULL) {
+		return false;
+	}
+
+	strm->next_in = p->getPayload();
+	strm->avail_in = uncompressedsize;
+	strm->next_out = compressed;
+	strm->avail_out = size;
+
+	// from here on the stream contains the payload, errors break the stream
+	while(true) {
+		int rc = deflate(strm, Z_SYNC_FLUSH);
+
+		if(rc != Z_OK && rc != Z_BUF_ERROR) {
+			break;
+		}
+
+		if(strm->avail_in == 0 && strm->avail_out != 0) {
+			break;
+		}
+
+		uint32_t used = size - strm->avail_out;
+		uint8_t* buffer = (uint8_t*)realloc(compressed, size * 2);
+
+		if(buffer == NULL) {
+			break;
+		}
+
+		compressed = buffer;
+		strm->next_out = compressed + used;
+		strm->avail_out = size * 2 - used;
+		size *= 2;
+	}
+
+	if(strm->avail_in != 0 || strm->avail_out == 0) {
+		m_failed = true;
+		free(compressed);
+		return false;
+	}
+
+	uint32_t compressedsize = size - strm->avail_out;
+
+	p->clear();
+	uint8_t* data = p->reserve(compressedsize);
+
+	if(data == NULL) {
+		m_failed = true;
+		free(compressed);
+		return false;
+	}
+
+	memcpy(data, compressed, compressedsize);
+	free(compressed);
+
+	p->writePacket<uint32_t>(MsgPacket::UncompressedPayloadLengthPos, htobe32(uncompressedsize | (MsgPacket::CodecZlibStream << MsgPacket::CodecShift)));
+	p->freeze();
+
+	return true;
+#endif
+}
+
+bool MsgCompressor::uncompress(MsgPacket* p) {
+#ifndef HAVE_ZLIB
+	return false;
+#else
+
+	if(!p->isCompressed() || p->getCodec() != MsgPacket::CodecZlibStream) {
+		return p->uncompress();
+	}
+
+	if(m_failed) {
+		return false;
+	}
+
+	if(m_inflate == NULL) {
+		z_stream* strm = (z_stream*)calloc(1, sizeof(z_stream));
+
+		if(strm == NULL) {
+			return false;
+		}
+
+		if(inflateInit(strm) != Z_OK) {
+			free(strm);
+			return false;
+		}
+
+		m_inflate = strm;
+	}
+
+	z_stream* strm = (z_stream*)m_inflate;
+	uint32_t uncompressedsize = be32toh(p->readPacket<uint32_t>(MsgPacket::UncompressedPayloadLengthPos)) & MsgPacket::UncompressedLengthMask;
+
+	// one spare byte, so inflate doesn't stop in front of the flush marker
+	uint8_t* uncompressed = (uint8_t*)malloc(uncompressedsize + 1);
+
+	if(uncompressed == NULL) {
+		return false;
+	}
+
+	strm->next_in = p->getPayload();
+	strm->avail_in = p->getPayloadLength();
+	strm->next_out = uncompressed;
+	strm->avail_out = uncompressedsize + 1;
+
+	int rc = inflate(strm, Z_SYNC_FLUSH);
+
+	if((rc != Z_OK && rc != Z_BUF_ERROR) || strm->avail_in != 0 || strm->avail_out != 1) {
+		m_failed = true;
+		free(uncompressed);
+		return false;
+	}
+
+	p->clear();
+	uint8_t* data = p->reserve(uncompressedsize);
+
+	if(data == NULL) {
+		free(uncompressed);
+		return false;
+	}
+
+	memcpy(data, uncompressed, uncompressedsize);
+	free(uncompressed);
+
+	p->writePacket<uint32_t>(MsgPacket::UncompressedPayloadLengthPos, htobe32(0));
+
+	p->m_freezed = false;
+	p->freeze();
+
+	return true;
+#endif
+}
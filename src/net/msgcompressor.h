@@ -0,0 +1,75 @@
+/** \file msgcompressor.h
+	Header file for the MsgCompressor class.
+	This include file defines the MsgCompressor class
+*/
+
+#ifndef MSGCOMPRESSOR_H
+#define MSGCOMPRESSOR_H
+
+#include <stdint.h>
+
+class MsgPacket;
+
+/**
+	@short Streaming packet compressor
+
+	Compresses the payloads of consecutive packets with one zlib stream per
+	connection. The compression window is kept across packets, so strings repeated
+	in later responses (channel names, EPG texts, ...) are encoded as back-references.
+	Each packet is flushed (Z_SYNC_FLUSH), so it can be decoded as soon as it has been
+	received. Packets must be decoded in the same order they have been compressed.
+*/
+
+class MsgCompressor {
+public:
+
+	/**
+	MsgCompressor constructor.
+
+	@param	level	compression level (1 - 9)
+	*/
+	MsgCompressor(int level = 6);
+
+	/**
+	Destructor.
+	*/
+	~MsgCompressor();
+
+	/**
+	Compress packet.
+	Compress the payload of the packet with the connection stream. Once a payload has
+	been passed to the stream the packet has to be sent, even if it didn't get smaller.
+
+	@param	p		packet to compress
+	@return true on success
+	*/
+	bool compress(MsgPacket* p);
+
+	/**
+	Uncompress packet.
+	Uncompress a packet compressed by the peers stream. Other packets are left untouched.
+
+	@param	p		packet to uncompress
+	@return true on success
+	*/
+	bool uncompress(MsgPacket* p);
+
+	/**
+	Set compression level.
+	Only effective before the first packet has been compressed.
+
+	@param	level	compression level (1 - 9)
+	*/
+	void setLevel(int level);
+
+private:
+
+	int m_level;
+
+	void* m_deflate;
+	void* m_inflate;
+
+	bool m_failed;
+};
+
+#endif // MSGCOMPRESSOR_H
@@ -6,6 +6,14 @@
 #include <zlib.h>
 #endif
 
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
@@ -13,6 +21,9 @@
 #include <unistd.h>
 
 #include "os-config.h"
+#include "crc32.h"
+#include "msgbuffer.h"
+#include "msgpool.h"
 #include "msgpacket.h"
 
 #define get_impl(T, f) \
@@ -35,67 +46,25 @@ pthread_mutex_t MsgPacket::uidmutex = PTHREAD_MUTEX_INITIALIZER;
 
 uint32_t MsgPacket::globalUID = 1;
 
-uint32_t MsgPacket::crc32_tab[] = {
-	0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
-	0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
-	0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91, 0x1db71064, 0x6ab020f2,
-	0xf3b97148, 0x84be41de, 0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
-	0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec, 0x14015c4f, 0x63066cd9,
-	0xfa0f3d63, 0x8d080df5, 0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172,
-	0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b, 0x35b5a8fa, 0x42b2986c,
-	0xdbbbc9d6, 0xacbcf940, 0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
-	0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116, 0x21b4f4b5, 0x56b3c423,
-	0xcfba9599, 0xb8bda50f, 0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924,
-	0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d, 0x76dc4190, 0x01db7106,
-	0x98d220bc, 0xefd5102a, 0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
-	0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818, 0x7f6a0dbb, 0x086d3d2d,
-	0x91646c97, 0xe6635c01, 0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e,
-	0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457, 0x65b0d9c6, 0x12b7e950,
-	0x8bbeb8ea, 0xfcb9887c, 0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
-	0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2, 0x4adfa541, 0x3dd895d7,
-	0xa4d1c46d, 0xd3d6f4fb, 0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0,
-	0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9, 0x5005713c, 0x270241aa,
-	0xbe0b1010, 0xc90c2086, 0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
-	0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4, 0x59b33d17, 0x2eb40d81,
-	0xb7bd5c3b, 0xc0ba6cad, 0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a,
-	0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683, 0xe3630b12, 0x94643b84,
-	0x0d6d6a3e, 0x7a6a5aa8, 0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
-	0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe, 0xf762575d, 0x806567cb,
-	0x196c3671, 0x6e6b06e7, 0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc,
-	0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5, 0xd6d6a3e8, 0xa1d1937e,
-	0x38d8c2c4, 0x4fdff252, 0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
-	0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60, 0xdf60efc3, 0xa867df55,
-	0x316e8eef, 0x4669be79, 0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236,
-	0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f, 0xc5ba3bbe, 0xb2bd0b28,
-	0x2bb45a92, 0x5cb36a04, 0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
-	0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a, 0x9c0906a9, 0xeb0e363f,
-	0x72076785, 0x05005713, 0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38,
-	0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21, 0x86d3d2d4, 0xf1d4e242,
-	0x68ddb3f8, 0x1fda836e, 0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
-	0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c, 0x8f659eff, 0xf862ae69,
-	0x616bffd3, 0x166ccf45, 0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2,
-	0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db, 0xaed16a4a, 0xd9d65adc,
-	0x40df0b66, 0x37d83bf0, 0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
-	0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6, 0xbad03605, 0xcdd70693,
-	0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
-	0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
-};
-
-
-MsgPacket::MsgPacket() : m_packet(NULL), m_size(InitialPacketSize), m_usage(HeaderLength), m_readposition(HeaderLength), m_freezed(false), m_payloadchecksum(true) {
+
+MsgPacket::MsgPacket() : m_packet(NULL), m_size(InitialPacketSize), m_usage(HeaderLength), m_readposition(HeaderLength), m_buffer(NULL), m_bufferoffset(0), m_bufferlength(0), m_freezed(false), m_payloadchecksum(true), m_checksum(true) {
 	Init(0, 0, 0);
 }
 
-MsgPacket::MsgPacket(uint16_t msgid, uint16_t type, uint32_t uid) : m_packet(NULL), m_size(InitialPacketSize), m_usage(HeaderLength), m_readposition(HeaderLength), m_freezed(false), m_payloadchecksum(true) {
+MsgPacket::MsgPacket(uint16_t msgid, uint16_t type, uint32_t uid) : m_packet(NULL), m_size(InitialPacketSize), m_usage(HeaderLength), m_readposition(HeaderLength), m_buffer(NULL), m_bufferoffset(0), m_bufferlength(0), m_freezed(false), m_payloadchecksum(true), m_checksum(true) {
 	Init(msgid, type, uid);
 }
 
 MsgPacket::~MsgPacket() {
-	free(m_packet);
+	if(m_buffer != NULL) {
+		m_buffer->unref();
+	}
+
+	MsgPool::release(m_packet, m_size);
 }
 
 void MsgPacket::Init(uint16_t msgid, uint16_t type, uint32_t uid) {
-	m_packet = (uint8_t*)malloc(m_size);
+	m_packet = MsgPool::alloc(InitialPacketSize, m_size);
 
 	if(m_packet == NULL) {
 		return;
@@ -140,6 +109,10 @@ void MsgPacket::disablePayloadCheckSum() {
 	m_payloadchecksum = false;
 }
 
+void MsgPacket::disableCheckSum() {
+	m_checksum = false;
+}
+
 bool MsgPacket::put_String(const char* string) {
 	uint32_t len = strlen(string) + 1;
 
@@ -181,6 +154,29 @@ bool MsgPacket::put_S64(int64_t ll) {
 	put_impl(int64_t, htobe64, ll);
 }
 
+bool MsgPacket::put_Varint(uint64_t ull) {
+	uint8_t buffer[10];
+	int length = 0;
+
+	do {
+		uint8_t b = ull & 0x7F;
+		ull >>= 7;
+
+		if(ull != 0) {
+			b |= 0x80;
+		}
+
+		buffer[length++] = b;
+	}
+	while(ull != 0);
+
+	return put_Blob(buffer, length);
+}
+
+bool MsgPacket::put_SVarint(int64_t ll) {
+	return put_Varint(((uint64_t)ll << 1) ^ (uint64_t)(ll >> 63));
+}
+
 bool MsgPacket::put_Blob(uint8_t source[], uint32_t length) {
 	uint8_t* p = reserve(length);
 
@@ -192,7 +188,57 @@ bool MsgPacket::put_Blob(uint8_t source[], uint32_t length) {
 	return true;
 }
 
+bool MsgPacket::put_Buffer(MsgBuffer* buffer, uint32_t offset, uint32_t length) {
+	if(buffer == NULL || offset + length > buffer->size()) {
+		return false;
+	}
+
+	if(length == 0) {
+		return true;
+	}
+
+	// only one buffer can be attached
+	if(!flatten()) {
+		return false;
+	}
+
+	buffer->ref();
+
+	m_buffer = buffer;
+	m_bufferoffset = offset;
+	m_bufferlength = length;
+
+	return true;
+}
+
+bool MsgPacket::flatten() {
+	if(m_buffer == NULL) {
+		return true;
+	}
+
+	MsgBuffer* buffer = m_buffer;
+	uint32_t length = m_bufferlength;
+
+	m_buffer = NULL;
+	m_bufferlength = 0;
+
+	uint8_t* p = reserve(length);
+
+	if(p != NULL) {
+		memcpy(p, buffer->data() + m_bufferoffset, length);
+	}
+
+	buffer->unref();
+	return (p != NULL);
+}
+
 void MsgPacket::clear() {
+	if(m_buffer != NULL) {
+		m_buffer->unref();
+		m_buffer = NULL;
+		m_bufferlength = 0;
+	}
+
 	m_usage = HeaderLength;
 	m_readposition = HeaderLength;
 }
@@ -277,6 +323,26 @@ int64_t MsgPacket::get_S64() {
 	get_impl(int64_t, be64toh);
 }
 
+uint64_t MsgPacket::get_Varint() {
+	uint64_t ull = 0;
+
+	for(int shift = 0; m_readposition < m_usage && shift < 64; shift += 7) {
+		uint8_t b = m_packet[m_readposition++];
+		ull |= (uint64_t)(b & 0x7F) << shift;
+
+		if(!(b & 0x80)) {
+			break;
+		}
+	}
+
+	return ull;
+}
+
+int64_t MsgPacket::get_SVarint() {
+	uint64_t ull = get_Varint();
+	return (int64_t)(ull >> 1) ^ -(int64_t)(ull & 1);
+}
+
 bool MsgPacket::get_Blob(uint8_t dest[], uint32_t length) {
 	if((m_readposition + length) > m_usage) {
 		return false;
@@ -289,19 +355,21 @@ bool MsgPacket::get_Blob(uint8_t dest[], uint32_t length) {
 }
 
 uint8_t* MsgPacket::getPacket() {
+	flatten();
 	return m_packet;
 }
 
 uint32_t MsgPacket::getPacketLength() {
-	return m_usage;
+	return m_usage + m_bufferlength;
 }
 
 uint8_t* MsgPacket::getPayload() {
+	flatten();
 	return m_packet + HeaderLength;
 }
 
 uint32_t MsgPacket::getPayloadLength() {
-	return m_usage - HeaderLength;
+	return m_usage - HeaderLength + m_bufferlength;
 }
 
 uint32_t MsgPacket::getUID() {
@@ -348,12 +416,16 @@ void MsgPacket::freeze() {
 	uint32_t payloadCheckSum = 0;
 
 	if(getPayloadLength() > 0 && m_payloadchecksum) {
-		payloadCheckSum = crc32(m_packet + HeaderLength, m_usage - HeaderLength);
+		payloadCheckSum = crc32_update(0, m_packet + HeaderLength, m_usage - HeaderLength);
+
+		if(m_buffer != NULL) {
+			payloadCheckSum = crc32_update(payloadCheckSum, m_buffer->data() + m_bufferoffset, m_bufferlength);
+		}
 	}
 
 	writePacket<uint32_t>(PayloadCheckSumPos, htobe32(payloadCheckSum));
-	writePacket<uint32_t>(PayloadLengthPos, htobe32(m_usage - HeaderLength));
-	writePacket<uint32_t>(CheckSumPos, htobe32(crc32(m_packet, CheckSumPos)));
+	writePacket<uint32_t>(PayloadLengthPos, htobe32(getPayloadLength()));
+	writePacket<uint32_t>(CheckSumPos, htobe32(m_checksum ? crc32(m_packet, CheckSumPos) : 0));
 
 	m_freezed = true;
 }
@@ -363,6 +435,11 @@ bool MsgPacket::checkPacketSize(uint32_t bytes) {
 		return false;
 	}
 
+	// new data goes behind an attached buffer
+	if(!flatten()) {
+		return false;
+	}
+
 	if((m_usage + bytes) <= m_size) {
 		return true;
 	}
@@ -371,63 +448,171 @@ bool MsgPacket::checkPacketSize(uint32_t bytes) {
 		bytes = IncrementPacketSize;
 	}
 
-	uint8_t* buffer = (uint8_t*)realloc((void*)m_packet, m_usage + bytes);
+	uint32_t capacity = 0;
+	uint8_t* buffer = MsgPool::alloc(m_usage + bytes, capacity);
 
 	if(buffer == NULL) {
-		buffer = (uint8_t*)malloc(m_usage + bytes);
-
-		if(buffer == NULL) {
-			return false;
-		}
-
-		memcpy(buffer, m_packet, m_usage);
-		free(m_packet);
+		return false;
 	}
 
+	memcpy(buffer, m_packet, m_usage);
+	MsgPool::release(m_packet, m_size);
+
 	m_packet = buffer;
-	m_size = m_usage + bytes;
+	m_size = capacity;
 	return true;
 }
 
 uint32_t MsgPacket::crc32(const uint8_t* buf, int size) {
-	uint32_t crc = 0xFFFFFFFF;
-	const uint8_t* p = buf;
+	return crc32_compute(buf, size);
+}
 
-	while(size--) {
-		crc = crc32_tab[(crc ^ *p++) & 0xFF] ^(crc >> 8);
+int MsgPacket::getIOVec(struct iovec* iov) {
+	freeze();
+
+	iov[0].iov_base = m_packet;
+	iov[0].iov_len = m_usage;
+
+	if(m_buffer == NULL) {
+		return 1;
 	}
 
-	return (crc ^ ~0U);
+	iov[1].iov_base = m_buffer->data() + m_bufferoffset;
+	iov[1].iov_len = m_bufferlength;
+
+	return 2;
 }
 
 bool MsgPacket::write(int fd, int timeout_ms) {
-	freeze();
+	// header and payload go out in one go, attached buffers aren't copied
+	struct iovec iov[2];
+	int count = getIOVec(iov);
 
-	uint32_t written = 0;
+	return (socketwritev(fd, iov, count, timeout_ms) == 0);
+}
 
-	while(written < m_usage) {
-		if(pollfd(fd, timeout_ms, false) == 0) {
-			return false;
-		}
+bool MsgPacket::write(int fd, MsgPacket* packets[], int count, int timeout_ms) {
+	struct iovec iov[MaxIOVecs];
+	int used = 0;
 
-		int rc = send(fd, (sendval_t*)(m_packet + written), m_usage - written, MSG_DONTWAIT | MSG_NOSIGNAL);
+	for(int i = 0; i < count; i++) {
+		used += packets[i]->getIOVec(&iov[used]);
 
-		if(rc == -1 && sockerror() == ENOTSOCK) {
-			rc = ::write(fd, m_packet + written, m_usage - written);
+		// flush if the next packet may not fit
+		if(used > MaxIOVecs - 2 || i == count - 1) {
+			if(socketwritev(fd, iov, used, timeout_ms) != 0) {
+				return false;
+			}
+
+			used = 0;
 		}
+	}
+
+	return true;
+}
+
+int MsgPacket::send(int fd, MsgPacket* packets[], int count, uint32_t& offset) {
+	struct iovec iov[MaxIOVecs];
+	int i = 0;
+	uint32_t skip = offset;
+
+	while(i < count) {
+		int used = 0;
+		size_t length = 0;
 
-		if(rc == -1 || rc == 0) {
-			if(sockerror() == SEWOULDBLOCK) {
-				continue;
+		// the vectors behind the part already written
+		while(i < count && used <= MaxIOVecs - 2) {
+			struct iovec v[2];
+			int n = packets[i++]->getIOVec(v);
+
+			for(int k = 0; k < n; k++) {
+				if(skip >= v[k].iov_len) {
+					skip -= v[k].iov_len;
+					continue;
+				}
+
+				iov[used].iov_base = (uint8_t*)v[k].iov_base + skip;
+				iov[used].iov_len = v[k].iov_len - skip;
+				length += iov[used].iov_len;
+				skip = 0;
+				used++;
 			}
+		}
+
+		if(used == 0) {
+			continue;
+		}
+
+		int rc = socketsendv(fd, iov, used);
+
+		if(rc == 0) {
+			return ECONNRESET;
+		}
 
-			return false;
+		if(rc == -1) {
+			return (sockerror() == EINTR) ? SEWOULDBLOCK : sockerror();
 		}
 
-		written += rc;
+		offset += rc;
+
+		// the socket is full
+		if((size_t)rc < length) {
+			return SEWOULDBLOCK;
+		}
 	}
 
-	return true;
+	return 0;
+}
+
+MsgPacket* MsgPacket::clone() {
+	MsgPacket* p = new MsgPacket(0, 0, getUID());
+
+	if(p->getPacket() == NULL || (m_usage > HeaderLength && p->reserve(m_usage - HeaderLength) == NULL)) {
+		delete p;
+		return NULL;
+	}
+
+	memcpy(p->m_packet, m_packet, m_usage);
+
+	// share the attached buffer
+	if(m_buffer != NULL) {
+		m_buffer->ref();
+
+		p->m_buffer = m_buffer;
+		p->m_bufferoffset = m_bufferoffset;
+		p->m_bufferlength = m_bufferlength;
+	}
+
+	p->m_freezed = m_freezed;
+	p->m_payloadchecksum = m_payloadchecksum;
+	p->m_checksum = m_checksum;
+
+	return p;
+}
+
+uint32_t MsgPacket::copyTo(uint8_t* dest, uint32_t offset, uint32_t length) {
+	struct iovec iov[2];
+	int count = getIOVec(iov);
+	uint32_t copied = 0;
+
+	for(int i = 0; i < count && copied < length; i++) {
+		if(offset >= iov[i].iov_len) {
+			offset -= iov[i].iov_len;
+			continue;
+		}
+
+		uint32_t size = iov[i].iov_len - offset;
+
+		if(size > length - copied) {
+			size = length - copied;
+		}
+
+		memcpy(dest + copied, (uint8_t*)iov[i].iov_base + offset, size);
+		copied += size;
+		offset = 0;
+	}
+
+	return copied;
 }
 
 MsgPacket* MsgPacket::read(int fd, int timeout_ms) {
@@ -601,29 +786,72 @@ bool MsgPacket::readstream(std::istream& in, MsgPacket& p) {
 	return true;
 }
 
-bool MsgPacket::compress(int level) {
-#ifndef HAVE_ZLIB
-	return false;
-#else
-
+bool MsgPacket::compress(int level, int codec) {
 	if(level <= 0 || level > 9 || m_freezed) {
 		return false;
 	}
 
+	if(!(getCodecs() & (1 << codec))) {
+		return false;
+	}
+
 	uint32_t uncompressedsize = getPayloadLength();
 
 	if(uncompressedsize == 0) {
 		return true;
 	}
 
+	if(uncompressedsize > UncompressedLengthMask) {
+		return false;
+	}
+
+	// compression fails if the payload doesn't get smaller
 	uint8_t* compressed = (uint8_t*)malloc(uncompressedsize);
-	uLongf compressedsize = uncompressedsize;
+	uint32_t compressedsize = 0;
 
 	if(compressed == NULL) {
-		return NULL;
+		return false;
 	}
 
-	if(::compress2(compressed, &compressedsize, getPayload(), uncompressedsize, level) != Z_OK) {
+	switch(codec) {
+#ifdef HAVE_ZLIB
+		case CodecZlib: {
+			uLongf size = uncompressedsize;
+
+			if(::compress2(compressed, &size, getPayload(), uncompressedsize, level) == Z_OK) {
+				compressedsize = size;
+			}
+
+			break;
+		}
+#endif
+#ifdef HAVE_LZ4
+		case CodecLZ4: {
+			int size = LZ4_compress_default((const char*)getPayload(), (char*)compressed, uncompressedsize, uncompressedsize);
+
+			if(size > 0) {
+				compressedsize = size;
+			}
+
+			break;
+		}
+#endif
+#ifdef HAVE_ZSTD
+		case CodecZstd: {
+			size_t size = ZSTD_compress(compressed, uncompressedsize, getPayload(), uncompressedsize, level);
+
+			if(!ZSTD_isError(size)) {
+				compressedsize = size;
+			}
+
+			break;
+		}
+#endif
+		default:
+			break;
+	}
+
+	if(compressedsize == 0) {
 		free(compressed);
 		return false;
 	}
@@ -640,25 +868,75 @@ bool MsgPacket::compress(int level) {
 	free(compressed);
 
 	m_freezed = false;
-	writePacket<uint32_t>(UncompressedPayloadLengthPos, htobe32(uncompressedsize));
+	writePacket<uint32_t>(UncompressedPayloadLengthPos, htobe32(uncompressedsize | (codec << CodecShift)));
 	freeze();
 
 	return true;
-#endif
 }
 
 bool MsgPacket::isCompressed() {
 	return (be32toh(readPacket<uint32_t>(UncompressedPayloadLengthPos)) != 0);
 }
 
+int MsgPacket::getCodec() {
+	return be32toh(readPacket<uint32_t>(UncompressedPayloadLengthPos)) >> CodecShift;
+}
+
+uint32_t MsgPacket::getCodecs() {
+	uint32_t codecs = 0;
+
+#ifdef HAVE_ZLIB
+	codecs |= (1 << CodecZlib);
+	codecs |= (1 << CodecZlibStream);
+#endif
+#ifdef HAVE_LZ4
+	codecs |= (1 << CodecLZ4);
+#endif
+#ifdef HAVE_ZSTD
+	codecs |= (1 << CodecZstd);
+#endif
+
+	return codecs;
+}
+
 bool MsgPacket::uncompress() {
-#ifndef HAVE_ZLIB
-	return false;
-#else
-	uLongf uncompressedsize = be32toh(readPacket<uint32_t>(UncompressedPayloadLengthPos));
+	int codec = getCodec();
+	uint32_t uncompressedsize = be32toh(readPacket<uint32_t>(UncompressedPayloadLengthPos)) & UncompressedLengthMask;
+
+	if(!(getCodecs() & (1 << codec))) {
+		return false;
+	}
+
 	uint8_t* uncompressed = (uint8_t*)malloc(uncompressedsize);
+	bool rc = false;
+
+	if(uncompressed == NULL) {
+		return false;
+	}
+
+	switch(codec) {
+#ifdef HAVE_ZLIB
+		case CodecZlib: {
+			uLongf size = uncompressedsize;
+			rc = (::uncompress(uncompressed, &size, getPayload(), getPayloadLength()) == Z_OK && size == uncompressedsize);
+			break;
+		}
+#endif
+#ifdef HAVE_LZ4
+		case CodecLZ4:
+			rc = (LZ4_decompress_safe((const char*)getPayload(), (char*)uncompressed, getPayloadLength(), uncompressedsize) == (int)uncompressedsize);
+			break;
+#endif
+#ifdef HAVE_ZSTD
+		case CodecZstd:
+			rc = (ZSTD_decompress(uncompressed, uncompressedsize, getPayload(), getPayloadLength()) == uncompressedsize);
+			break;
+#endif
+		default:
+			break;
+	}
 
-	if(::uncompress(uncompressed, &uncompressedsize, getPayload(), getPayloadLength()) != Z_OK) {
+	if(!rc) {
 		free(uncompressed);
 		return false;
 	}
@@ -680,7 +958,6 @@ bool MsgPacket::uncompress() {
 	freeze();
 
 	return true;
-#endif
 }
 
 void MsgPacket::print() {
@@ -13,6 +13,9 @@
 #include <ostream>
 #include <istream>
 
+class MsgBuffer;
+struct iovec;
+
 // PACKET HEADER DEFINITION
 
 // pos    type       description
@@ -25,7 +28,8 @@
 // 16     uint32_t   payload checksum (0 if payload checksums are disabled)
 // 20     uint32_t   payload length
 // 24     uint32_t   uncompressed payload length (indicates compression if > 0)
-// 28     uint32_t   header checksum
+//                   bits 28-31: payload codec (0 = zlib, 1 = LZ4, 2 = zstd, 3 = zlib stream)
+// 28     uint32_t   header checksum (0 if header checksums are disabled)
 
 /**
 	@short Message Packet class
@@ -130,6 +134,24 @@ public:
 	*/
 	bool put_S64(int64_t ll);
 
+	/**
+	Insert unsigned variable length integer.
+	Adds an unsigned integer number as LEB128 varint (7 bits per byte) to the payload of the packet.
+
+	@param	ull		unsigned number
+	@return true on success / false on memory allocation error
+	*/
+	bool put_Varint(uint64_t ull);
+
+	/**
+	Insert signed variable length integer.
+	Adds a signed integer number as zigzag encoded LEB128 varint to the payload of the packet.
+
+	@param	ll		signed number
+	@return true on success / false on memory allocation error
+	*/
+	bool put_SVarint(int64_t ll);
+
 	/**
 	Insert a binary large object.
 	Adds a binary object to the payload of the packet.
@@ -140,6 +162,20 @@ public:
 	*/
 	bool put_Blob(uint8_t source[], uint32_t length);
 
+	/**
+	Attach a shared buffer.
+	Appends a region of a shared buffer to the payload of the packet without copying it.
+	The packet holds a reference to the buffer until it is destroyed or cleared. The region
+	is sent along with the packet data in a single scatter/gather write. Any other payload
+	modification (and getPacket() / getPayload()) copies the region into the packet first.
+
+	@param	buffer		shared buffer
+	@param	offset		offset of the region within the buffer
+	@param	length		size of the region in bytes
+	@return true on success / false on memory allocation error
+	*/
+	bool put_Buffer(MsgBuffer* buffer, uint32_t offset, uint32_t length);
+
 	/**
 	Reserve space.
 	Creates a memory region in the payload of the packet.
@@ -246,6 +282,24 @@ public:
 	*/
 	int64_t get_S64();
 
+	/**
+	Extract unsigned variable length integer.
+	Return the LEB128 varint at the current payload position pointer. The internal payload pointer will be incremented
+	by the size of the encoded number for the next "extract" call.
+
+	@return unsigned integer at current payload position
+	*/
+	uint64_t get_Varint();
+
+	/**
+	Extract signed variable length integer.
+	Return the zigzag encoded LEB128 varint at the current payload position pointer. The internal payload pointer will be incremented
+	by the size of the encoded number for the next "extract" call.
+
+	@return signed integer at current payload position
+	*/
+	int64_t get_SVarint();
+
 	/**
 	Extract binary large object.
 	Copy "length" bytes from the current payload position to "dest". The internal payload pointer will be incremented
@@ -366,6 +420,13 @@ public:
 	*/
 	void disablePayloadCheckSum();
 
+	/**
+	Disable the header checksum.
+	The header checksum will be set to 0 (no checksum). Use only if the receiver
+	has agreed to accept packets without header checksums.
+	*/
+	void disableCheckSum();
+
 	/**
 	Get protocol version.
 	Return the user defined protocol version
@@ -403,12 +464,29 @@ public:
 	Compress the payload of the packet
 
 	@param level compression level (1 - 9)
+	@param codec payload codec (default: zlib)
 	@return true on success
 	*/
-	bool compress(int level);
+	bool compress(int level, int codec = CodecZlib);
 
 	bool isCompressed();
 
+	/**
+	Get payload codec.
+	Returns the codec of a compressed packet
+
+	@return payload codec
+	*/
+	int getCodec();
+
+	/**
+	Get available codecs.
+	Returns the codecs compiled into this build
+
+	@return bitmask of codecs (1 << codec)
+	*/
+	static uint32_t getCodecs();
+
 	/**
 	Uncompress packet.
 	Uncompress the payload of the packet
@@ -428,6 +506,31 @@ public:
 	*/
 	bool write(int fd, int timeout_ms = 3000);
 
+	/**
+	Write packets to socket.
+	Writes multiple packets with as few scatter/gather writes as possible
+
+	@param	fd			filedescriptor of the socket
+	@param	packets		array of packets
+	@param	count		number of packets in the array
+	@param	timeout_ms	write operation timeout in milliseconds
+	*/
+	static bool write(int fd, MsgPacket* packets[], int count, int timeout_ms = 3000);
+
+	/**
+	Send packets without blocking.
+	Writes as much of the packets as the socket takes right now. The write starts
+	at the given byte offset (into all packets), which is advanced by the bytes written.
+	Call it again with the same packets when the socket is writable.
+
+	@param	fd			filedescriptor of the socket
+	@param	packets		array of packets
+	@param	count		number of packets in the array
+	@param	offset		bytes already written
+	@return 0 if all packets have been written, SEWOULDBLOCK if the socket is full, or an error code
+	*/
+	static int send(int fd, MsgPacket* packets[], int count, uint32_t& offset);
+
 	/**
 	Receive packet from socket.
 	Create a new packet from incoming socket data
@@ -449,6 +552,26 @@ public:
 	*/
 	static MsgPacket* read(int fd, bool& closed, int timeout_ms = 3000);
 
+	/**
+	Clone packet.
+	Creates a copy of the packet. An attached buffer is shared, not copied.
+
+	@return pointer to new packet or NULL on memory allocation error
+	*/
+	MsgPacket* clone();
+
+	/**
+	Copy packet data.
+	Copies a part of the complete packet (header, payload and attached buffer) to memory.
+	The packet will be frozen.
+
+	@param	dest	destination buffer
+	@param	offset	offset of the first byte to copy
+	@param	length	number of bytes to copy
+	@return number of bytes copied
+	*/
+	uint32_t copyTo(uint8_t* dest, uint32_t offset, uint32_t length);
+
 	static bool readstream(std::istream& in, MsgPacket& p);
 
 	enum {
@@ -465,6 +588,15 @@ public:
 		SyncPos = 0								/*!< sync-mark position (uint32_t). */
 	};
 
+	enum {
+		CodecZlib = 0,							/*!< zlib (default, understood by all clients). */
+		CodecLZ4 = 1,							/*!< LZ4 (fast). */
+		CodecZstd = 2,							/*!< zstd (dense). */
+		CodecZlibStream = 3,					/*!< zlib stream per connection (see MsgCompressor). */
+		CodecShift = 28,						/*!< bit position of the codec within the uncompressed payload length. */
+		UncompressedLengthMask = 0x0FFFFFFF		/*!< uncompressed payload length bits. */
+	};
+
 protected:
 
 	void Init(uint16_t msgid, uint16_t type = 0, uint32_t uid = 0);
@@ -504,23 +636,35 @@ private:
 
 	bool checkPacketSize(uint32_t bytes);
 
+	bool flatten();
+
+	int getIOVec(struct iovec* iov);
+
 	static uint32_t globalUID;
-	static uint32_t crc32_tab[];
 
 	uint8_t* m_packet;
 	uint32_t m_size;
 	uint32_t m_usage;
 	uint32_t m_readposition;
 
+	MsgBuffer* m_buffer;
+	uint32_t m_bufferoffset;
+	uint32_t m_bufferlength;
+
 	bool m_freezed;
 	bool m_payloadchecksum;
+	bool m_checksum;
 
 	enum {
 		InitialPacketSize = 128,
-		IncrementPacketSize = 512
+		IncrementPacketSize = 512,
+		MaxIOVecs = 128
 	};
 
 	static pthread_mutex_t uidmutex;
+
+	friend class MsgCompressor;
+	friend class MsgReader;
 };
 
 inline std::ostream& operator<<(std::ostream& out, MsgPacket& p) {
@@ -555,7 +699,10 @@ class MsgPacket {
 +bool put_S32(int32_t l)
 +bool put_U64(uint64_t ull)
 +bool put_S64(int64_t ll)
++bool put_Varint(uint64_t ull)
++bool put_SVarint(int64_t ll)
 +bool put_Blob(uint8_t source[], uint32_t length)
++bool put_Buffer(MsgBuffer* buffer, uint32_t offset, uint32_t length)
 .. data getters ..
 +const char* get_String()
 +uint8_t get_U8()
@@ -565,17 +712,23 @@ class MsgPacket {
 +int32_t get_S32()
 +uint64_t get_U64()
 +int64_t get_S64()
++uint64_t get_Varint()
++int64_t get_SVarint()
 +bool get_Blob(uint8_t dest[], uint32_t length)
 .. memory allocation ..
 +uint8_t* reserve(uint32_t length, bool fill, unsigned char c)
 +uint8_t* consume(uint32_t length)
 +void clear()
 .. compression ..
-+bool compress(int level)
++bool compress(int level, int codec)
 +bool uncompress()
 .. transport ..
 +{static} MsgPacket* read(int fd, bool& closed, int timeout_ms)
 +bool write(int fd, int timeout_ms)
++{static} bool write(int fd, MsgPacket* packets[], int count, int timeout_ms)
++{static} int send(int fd, MsgPacket* packets[], int count, uint32_t& offset)
++MsgPacket* clone()
++uint32_t copyTo(uint8_t* dest, uint32_t offset, uint32_t length)
 --
 -{static} uint32_t globalUID
 -uint8_t* m_packet;
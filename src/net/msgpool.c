@@ -0,0 +1,204 @@
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "msgpool.h"
+
+// free buffers are chained through their first bytes
+struct MsgPoolItem {
+	MsgPoolItem* next;
+};
+
+struct MsgPoolList {
+	MsgPoolItem* head;
+	uint32_t count;
+};
+
+struct MsgPoolCache {
+	MsgPoolList list[MsgPool::SizeClasses];
+};
+
+static MsgPoolList poolglobal[MsgPool::SizeClasses];
+
+static pthread_mutex_t poolmutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_key_t poolkey;
+
+static pthread_once_t poolonce = PTHREAD_ONCE_INIT;
+
+static uint64_t poolhits = 0;
+
+static uint64_t poolmisses = 0;
+
+static inline void pool_push(MsgPoolList& list, MsgPoolItem* item) {
+	item->next = list.head;
+	list.head = item;
+	list.count++;
+}
+
+static inline MsgPoolItem* pool_pop(MsgPoolList& list) {
+	MsgPoolItem* item = list.head;
+
+	if(item != NULL) {
+		list.head = item->next;
+		list.count--;
+	}
+
+	return item;
+}
+
+// move all buffers of an exiting thread to the global list (or free them)
+static void pool_thread_exit(void* data) {
+	MsgPoolCache* cache = (MsgPoolCache*)data;
+
+	pthread_mutex_lock(&poolmutex);
+
+	for(int c = 0; c < MsgPool::SizeClasses; c++) {
+		uint32_t limit = MsgPool::GlobalCacheBytes / (MsgPool::MinClassSize << (2 * c));
+		MsgPoolItem* item;
+
+		while((item = pool_pop(cache->list[c])) != NULL) {
+			if(poolglobal[c].count < limit) {
+				pool_push(poolglobal[c], item);
+			}
+			else {
+				free(item);
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&poolmutex);
+
+	free(cache);
+}
+
+static void pool_init() {
+	pthread_key_create(&poolkey, pool_thread_exit);
+}
+
+static MsgPoolCache* pool_cache() {
+	pthread_once(&poolonce, pool_init);
+
+	MsgPoolCache* cache = (MsgPoolCache*)pthread_getspecific(poolkey);
+
+	if(cache == NULL) {
+		cache = (MsgPoolCache*)calloc(1, sizeof(MsgPoolCache));
+
+		if(cache != NULL) {
+			pthread_setspecific(poolkey, cache);
+		}
+	}
+
+	return cache;
+}
+
+int MsgPool::sizeClass(uint32_t size) {
+	uint32_t s = MinClassSize;
+
+	for(int c = 0; c < SizeClasses; c++, s <<= 2) {
+		if(size <= s) {
+			return c;
+		}
+	}
+
+	return -1;
+}
+
+uint32_t MsgPool::classSize(int c) {
+	return MinClassSize << (2 * c);
+}
+
+uint8_t* MsgPool::alloc(uint32_t size, uint32_t& capacity) {
+	int c = sizeClass(size);
+
+	// too big for the pool
+	if(c == -1) {
+		__sync_add_and_fetch(&poolmisses, 1);
+		capacity = size;
+		return (uint8_t*)malloc(size);
+	}
+
+	capacity = classSize(c);
+	MsgPoolCache* cache = pool_cache();
+
+	if(cache == NULL) {
+		__sync_add_and_fetch(&poolmisses, 1);
+		return (uint8_t*)malloc(capacity);
+	}
+
+	MsgPoolList& local = cache->list[c];
+
+	// refill the thread cache with a batch of global buffers. the global
+	// list is only looked at under the lock, other threads change it.
+	if(local.count == 0) {
+		pthread_mutex_lock(&poolmutex);
+
+		MsgPoolItem* item;
+
+		while(local.count < ThreadCacheSize / 2 && (item = pool_pop(poolglobal[c])) != NULL) {
+			pool_push(local, item);
+		}
+
+		pthread_mutex_unlock(&poolmutex);
+	}
+
+	MsgPoolItem* item = pool_pop(local);
+
+	if(item != NULL) {
+		__sync_add_and_fetch(&poolhits, 1);
+		return (uint8_t*)item;
+	}
+
+	__sync_add_and_fetch(&poolmisses, 1);
+	return (uint8_t*)malloc(capacity);
+}
+
+void MsgPool::release(uint8_t* buffer, uint32_t capacity) {
+	if(buffer == NULL) {
+		return;
+	}
+
+	int c = sizeClass(capacity);
+
+	// not a pool buffer
+	if(c == -1 || classSize(c) != capacity) {
+		free(buffer);
+		return;
+	}
+
+	MsgPoolCache* cache = pool_cache();
+
+	if(cache == NULL) {
+		free(buffer);
+		return;
+	}
+
+	MsgPoolList& local = cache->list[c];
+
+	// buffers are often released by another thread than the one that allocated them
+	// (e.g. live stream packets), so pass surplus buffers to the global list
+	if(local.count >= ThreadCacheSize) {
+		uint32_t limit = GlobalCacheBytes / capacity;
+
+		pthread_mutex_lock(&poolmutex);
+
+		while(local.count > ThreadCacheSize / 2) {
+			MsgPoolItem* item = pool_pop(local);
+
+			if(poolglobal[c].count < limit) {
+				pool_push(poolglobal[c], item);
+			}
+			else {
+				free(item);
+			}
+		}
+
+		pthread_mutex_unlock(&poolmutex);
+	}
+
+	pool_push(local, (MsgPoolItem*)buffer);
+}
+
+void MsgPool::getStats(uint64_t& hits, uint64_t& misses) {
+	hits = __sync_fetch_and_add(&poolhits, 0);
+	misses = __sync_fetch_and_add(&poolmisses, 0);
+}
@@ -0,0 +1,64 @@
+/** \file msgpool.h
+	Header file for the MsgPool class.
+	This include file defines the MsgPool class
+*/
+
+#ifndef MSGPOOL_H
+#define MSGPOOL_H
+
+#include <stdint.h>
+
+/**
+	@short Packet buffer pool
+
+	Thread-safe pool of packet buffers used by MsgPacket. Buffers are
+	organized in size classes. Every thread keeps a small cache of free buffers
+	per class, surplus buffers are exchanged in batches with a global list.
+	Requests larger than the biggest size class are passed to malloc.
+*/
+
+class MsgPool {
+public:
+
+	/**
+	Allocate a buffer.
+	Returns a buffer of at least "size" bytes.
+
+	@param	size		minimum size of the buffer in bytes
+	@param	capacity	receives the real size of the buffer
+	@return pointer to the buffer or NULL if memory allocation failed
+	*/
+	static uint8_t* alloc(uint32_t size, uint32_t& capacity);
+
+	/**
+	Release a buffer.
+	Returns a buffer to the pool.
+
+	@param	buffer		buffer returned by alloc()
+	@param	capacity	capacity of the buffer as returned by alloc()
+	*/
+	static void release(uint8_t* buffer, uint32_t capacity);
+
+	/**
+	Get pool statistics.
+
+	@param	hits		number of allocations served from the pool
+	@param	misses		number of allocations passed to malloc
+	*/
+	static void getStats(uint64_t& hits, uint64_t& misses);
+
+	enum {
+		SizeClasses = 7,						/*!< Number of size classes (128 bytes - 512 kB). */
+		MinClassSize = 128,						/*!< Size of the smallest class. */
+		ThreadCacheSize = 16,					/*!< Free buffers per class cached in each thread. */
+		GlobalCacheBytes = 4 * 1024 * 1024		/*!< Maximum memory per class held in the global list. */
+	};
+
+private:
+
+	static int sizeClass(uint32_t size);
+
+	static uint32_t classSize(int c);
+};
+
+#endif // MSGPOOL_H
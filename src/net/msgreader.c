@@ -0,0 +1,269 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <iostream>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "os-config.h"
+#include "crc32.h"
+#include "msgpacket.h"
+#include "msgreader.h"
+
+MsgReader::MsgReader(int fd, uint32_t size) : m_fd(fd), m_nochecksum(false), m_skipped(0), m_size(size), m_start(0), m_end(0) {
+	m_buffer = (uint8_t*)malloc(m_size);
+
+	if(m_buffer == NULL) {
+		m_size = 0;
+	}
+}
+
+MsgReader::~MsgReader() {
+	free(m_buffer);
+}
+
+void MsgReader::acceptNoCheckSum(bool accept) {
+	m_nochecksum = accept;
+}
+
+uint32_t MsgReader::skippedBytes() {
+	uint32_t skipped = m_skipped;
+	m_skipped = 0;
+	return skipped;
+}
+
+uint32_t MsgReader::findSync(const uint8_t* data, uint32_t size) {
+	if(size < 4) {
+		return size;
+	}
+
+	uint32_t i = 0;
+
+#ifdef __SSE2__
+	// check 16 positions at once
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i aa = _mm_set1_epi8((char)0xAA);
+
+	for(; i + 19 <= size; i += 16) {
+		__m128i b0 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i)), zero);
+		__m128i b1 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i + 1)), aa);
+		__m128i b2 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i + 2)), aa);
+		__m128i b3 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i + 3)), aa);
+
+		int mask = _mm_movemask_epi8(_mm_and_si128(_mm_and_si128(b0, b1), _mm_and_si128(b2, b3)));
+
+		if(mask != 0) {
+			return i + __builtin_ctz(mask);
+		}
+	}
+
+#endif
+
+	// remaining bytes: look for the leading zero
+	uint32_t last = size - 3;
+
+	while(i < last) {
+		const uint8_t* p = (const uint8_t*)memchr(data + i, 0, last - i);
+
+		if(p == NULL) {
+			break;
+		}
+
+		i = p - data;
+
+		if(p[1] == 0xAA && p[2] == 0xAA && p[3] == 0xAA) {
+			return i;
+		}
+
+		i++;
+	}
+
+	return size;
+}
+
+bool MsgReader::checkHeader(const uint8_t* header, uint32_t& payloadlength, bool nochecksum) {
+	uint32_t sync = 0;
+	uint32_t checksum = 0;
+	uint32_t datalen = 0;
+
+	memcpy(&sync, header, sizeof(uint32_t));
+	memcpy(&checksum, header + MsgPacket::CheckSumPos, sizeof(uint32_t));
+	memcpy(&datalen, header + MsgPacket::PayloadLengthPos, sizeof(uint32_t));
+
+	checksum = be32toh(checksum);
+	payloadlength = be32toh(datalen);
+
+	if(be32toh(sync) != 0x00AAAAAA) {
+		return false;
+	}
+
+	bool valid = (nochecksum && checksum == 0) || checksum == crc32_compute(header, MsgPacket::CheckSumPos);
+
+	return valid && payloadlength <= MaxPayloadLength;
+}
+
+MsgPacket* MsgReader::decode(const uint8_t* data, uint32_t payloadlength) {
+	MsgPacket* p = new MsgPacket(0, 0, 1);
+
+	if(p->getPacket() == NULL) {
+		delete p;
+		return NULL;
+	}
+
+	memcpy(p->getPacket(), data, MsgPacket::HeaderLength);
+
+	if(payloadlength == 0) {
+		return p;
+	}
+
+	uint8_t* payload = p->reserve(payloadlength);
+
+	if(payload == NULL) {
+		delete p;
+		return NULL;
+	}
+
+	memcpy(payload, data + MsgPacket::HeaderLength, payloadlength);
+
+	// payload checksum validation
+	uint32_t plcs = p->getPayloadCheckSum();
+	p->m_payloadchecksum = (plcs != 0);
+
+	if(p->m_payloadchecksum && plcs != crc32_compute(payload, payloadlength)) {
+		std::cerr << "wrong payload checksum !" << std::endl;
+		delete p;
+		return NULL;
+	}
+
+	return p;
+}
+
+MsgPacket* MsgReader::parse(bool& garbage) {
+	garbage = false;
+
+	uint32_t available = m_end - m_start;
+	uint32_t offset = findSync(m_buffer + m_start, available);
+
+	// drop data in front of the sync (keep a possible partial sync mark)
+	if(offset == available) {
+		offset = (available > 3) ? available - 3 : 0;
+	}
+
+	m_start += offset;
+	m_skipped += offset;
+	available -= offset;
+
+	if(available < MsgPacket::HeaderLength) {
+		return NULL;
+	}
+
+	uint8_t* header = m_buffer + m_start;
+	uint32_t datalen = 0;
+
+	// header validation
+	if(!checkHeader(header, datalen, m_nochecksum)) {
+		m_start++;
+		m_skipped++;
+		garbage = true;
+		return NULL;
+	}
+
+	// incomplete packet
+	if(available < MsgPacket::HeaderLength + datalen) {
+		return NULL;
+	}
+
+	m_start += MsgPacket::HeaderLength + datalen;
+
+	MsgPacket* p = decode(header, datalen);
+
+	if(p == NULL) {
+		garbage = true;
+	}
+
+	return p;
+}
+
+bool MsgReader::fill(uint32_t bytes, bool& closed, int timeout_ms) {
+	// move remaining data to the front
+	if(m_start > 0) {
+		memmove(m_buffer, m_buffer + m_start, m_end - m_start);
+		m_end -= m_start;
+		m_start = 0;
+	}
+
+	// make room for big packets
+	if(bytes > m_size) {
+		uint8_t* buffer = (uint8_t*)realloc(m_buffer, bytes);
+
+		if(buffer == NULL) {
+			return false;
+		}
+
+		m_buffer = buffer;
+		m_size = bytes;
+	}
+
+	if(pollfd(m_fd, timeout_ms, true) == 0) {
+		return false;
+	}
+
+	int rc = recv(m_fd, (char*)(m_buffer + m_end), m_size - m_end, MSG_DONTWAIT);
+
+	if(rc == -1 && sockerror() == ENOTSOCK) {
+		rc = ::read(m_fd, m_buffer + m_end, m_size - m_end);
+	}
+
+	if(rc == 0) {
+		closed = true;
+		return false;
+	}
+	else if(rc == -1) {
+		if(sockerror() == SEWOULDBLOCK) {
+			return true;
+		}
+
+		closed = (sockerror() == ECONNRESET);
+		return false;
+	}
+
+	m_end += rc;
+	return true;
+}
+
+MsgPacket* MsgReader::read(bool& closed, int timeout_ms) {
+	closed = false;
+
+	if(m_buffer == NULL) {
+		return NULL;
+	}
+
+	while(true) {
+		bool garbage = false;
+		MsgPacket* p = parse(garbage);
+
+		if(p != NULL) {
+			return p;
+		}
+
+		// skip broken packets
+		if(garbage) {
+			continue;
+		}
+
+		// wait for the rest of the packet
+		uint32_t bytes = MsgPacket::HeaderLength;
+
+		if(m_end - m_start >= MsgPacket::HeaderLength) {
+			uint32_t datalen = 0;
+			memcpy(&datalen, m_buffer + m_start + MsgPacket::PayloadLengthPos, sizeof(uint32_t));
+			bytes += be32toh(datalen);
+		}
+
+		if(!fill(bytes, closed, timeout_ms)) {
+			return NULL;
+		}
+	}
+}
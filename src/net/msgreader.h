@@ -0,0 +1,120 @@
+/** \file msgreader.h
+	Header file for the MsgReader class.
+	This include file defines the MsgReader class
+*/
+
+#ifndef MSGREADER_H
+#define MSGREADER_H
+
+#include <stdint.h>
+
+class MsgPacket;
+
+/**
+	@short Buffered packet reader
+
+	Per-connection receive buffer. Incoming data is read in large chunks and
+	split into packets, so pipelined requests don't need separate system calls
+	for each header and payload.
+*/
+
+class MsgReader {
+public:
+
+	/**
+	MsgReader constructor.
+
+	@param	fd		filedescriptor of the socket
+	@param	size	initial size of the receive buffer
+	*/
+	MsgReader(int fd, uint32_t size = InitialBufferSize);
+
+	/**
+	Destructor.
+	*/
+	~MsgReader();
+
+	/**
+	Receive packet.
+	Returns the next packet from the receive buffer. The socket is only read
+	if the buffer doesn't contain a complete packet.
+
+	@param	closed		set to true if connection has been closed
+	@param	timeout_ms	read operation timeout in milliseconds
+	@return pointer to new packet or NULL on timeout
+	*/
+	MsgPacket* read(bool& closed, int timeout_ms = 3000);
+
+	/**
+	Accept packets without header checksum.
+	Packets with a header checksum of 0 will not be validated.
+
+	@param	accept	true to accept packets without header checksum
+	*/
+	void acceptNoCheckSum(bool accept = true);
+
+	/**
+	Skipped bytes.
+	Returns the number of bytes skipped to find the sync of the packets read
+	since the last call, and resets the counter. Lets the caller log a resync
+	once instead of every rejected sync candidate.
+
+	@return number of skipped bytes
+	*/
+	uint32_t skippedBytes();
+
+	/**
+	Find packet sync.
+	Searches for the packet sync mark (00 AA AA AA).
+
+	@param	data	pointer to data array
+	@param	size	size of array in bytes
+	@return offset of the sync mark or "size" if not found
+	*/
+	static uint32_t findSync(const uint8_t* data, uint32_t size);
+
+	/**
+	Check packet header.
+	Validates the sync mark, the header checksum and the payload length.
+
+	@param	header			pointer to the packet header
+	@param	payloadlength	set to the length of the payload
+	@param	nochecksum		accept headers without checksum
+	@return true if the header is valid
+	*/
+	static bool checkHeader(const uint8_t* header, uint32_t& payloadlength, bool nochecksum = false);
+
+	/**
+	Decode packet.
+	Creates a packet from a checked header and the following payload.
+
+	@param	data			pointer to the packet header (followed by the payload)
+	@param	payloadlength	length of the payload
+	@return pointer to new packet or NULL if the payload checksum is wrong
+	*/
+	static MsgPacket* decode(const uint8_t* data, uint32_t payloadlength);
+
+	enum {
+		InitialBufferSize = 64 * 1024,		/*!< Initial size of the receive buffer. */
+		MaxPayloadLength = 64 * 1024 * 1024	/*!< Packets with a bigger payload are treated as garbage. */
+	};
+
+private:
+
+	MsgPacket* parse(bool& garbage);
+
+	bool fill(uint32_t bytes, bool& closed, int timeout_ms);
+
+	int m_fd;
+
+	bool m_nochecksum;
+
+	uint32_t m_skipped;
+
+	uint8_t* m_buffer;
+	uint32_t m_size;
+	uint32_t m_start;
+	uint32_t m_end;
+};
+
+#endif // MSGREADER_H
@@ -0,0 +1,43 @@
+#include "msgpacket.h"
+#include "msgstringtable.h"
+
+MsgStringTable::MsgStringTable() {
+}
+
+bool MsgStringTable::put(MsgPacket* p, const char* string) {
+	if(string == NULL) {
+		string = "";
+	}
+
+	std::map<std::string, uint32_t>::iterator i = m_index.find(string);
+
+	if(i != m_index.end()) {
+		return p->put_Varint(i->second);
+	}
+
+	uint32_t index = m_index.size() + 1;
+	m_index[string] = index;
+
+	return p->put_Varint(0) && p->put_String(string);
+}
+
+const char* MsgStringTable::get(MsgPacket* p) {
+	uint64_t index = p->get_Varint();
+
+	if(index == 0) {
+		const char* string = p->get_String();
+		m_strings.push_back(string);
+		return string;
+	}
+
+	if(index > m_strings.size()) {
+		return "";
+	}
+
+	return m_strings[index - 1];
+}
+
+void MsgStringTable::clear() {
+	m_index.clear();
+	m_strings.clear();
+}
@@ -0,0 +1,67 @@
+/** \file msgstringtable.h
+	Header file for the MsgStringTable class.
+	This include file defines the MsgStringTable class
+*/
+
+#ifndef MSGSTRINGTABLE_H
+#define MSGSTRINGTABLE_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+class MsgPacket;
+
+/**
+	@short Per-packet string table
+
+	Encodes repeated strings (channel names, directories, titles of series, ...)
+	as references to their first occurrence in the same packet. Every string is
+	preceded by a varint: 0 means a new string follows (and is added to the table),
+	any other value n refers to the n-th string of the table.
+	One table has to be used for exactly one packet.
+*/
+
+class MsgStringTable {
+public:
+
+	/**
+	MsgStringTable constructor.
+	*/
+	MsgStringTable();
+
+	/**
+	Insert string.
+	Adds a string (or a reference to an already added string) to the payload of the packet.
+
+	@param	p		packet to add the string to
+	@param	string	string to add
+	@return true on success / false on memory allocation error
+	*/
+	bool put(MsgPacket* p, const char* string);
+
+	/**
+	Extract string.
+	Return the string at the current payload position of the packet. The returned pointer
+	points into the payload and is valid as long as the packet exists.
+
+	@param	p		packet to read the string from
+	@return string at current payload position
+	*/
+	const char* get(MsgPacket* p);
+
+	/**
+	Clear table.
+	Removes all strings, so the table can be used for another packet.
+	*/
+	void clear();
+
+private:
+
+	std::map<std::string, uint32_t> m_index;
+
+	std::vector<const char*> m_strings;
+};
+
+#endif // MSGSTRINGTABLE_H
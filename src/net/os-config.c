@@ -1,6 +1,8 @@
 #include "os-config.h"
+#include "uring.h"
 #include <unistd.h>
 #include <stdio.h>
+#include <string.h>
 #include <arpa/inet.h>
 
 // WINDOWS
@@ -106,6 +108,90 @@ int socketread(int fd, uint8_t* data, int datalen, int timeout_ms) {
         return 0;
 }
 
+int socketwritev(int fd, struct iovec* iov, int iovcnt, int timeout_ms) {
+#ifdef HAVE_LIBURING
+	int rc = uring_writev(fd, iov, iovcnt, timeout_ms);
+
+	if(rc != -1) {
+		return rc;
+	}
+#endif
+
+	// skip empty vectors
+	while(iovcnt > 0 && iov->iov_len == 0) {
+		iov++;
+		iovcnt--;
+	}
+
+	while(iovcnt > 0) {
+		if(pollfd(fd, timeout_ms, false) == 0) {
+			return ETIMEDOUT;
+		}
+
+#ifdef WIN32
+		int rc = send(fd, (sendval_t*)iov->iov_base, iov->iov_len, 0);
+#else
+		struct msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = iovcnt;
+
+		int rc = sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+		if(rc == -1 && sockerror() == ENOTSOCK) {
+			rc = ::writev(fd, iov, iovcnt);
+		}
+#endif
+
+		if(rc == 0) {
+			return ECONNRESET;
+		}
+		else if(rc == -1) {
+			if(sockerror() == SEWOULDBLOCK) {
+				continue;
+			}
+
+			return sockerror();
+		}
+
+		// advance vectors on partial writes
+		size_t written = rc;
+
+		while(iovcnt > 0 && written >= iov->iov_len) {
+			written -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+
+		if(iovcnt > 0) {
+			iov->iov_base = (uint8_t*)iov->iov_base + written;
+			iov->iov_len -= written;
+		}
+	}
+
+	return 0;
+}
+
+int socketsendv(int fd, struct iovec* iov, int iovcnt) {
+	// a single attempt, never waits for the socket
+#ifdef WIN32
+	return send(fd, (sendval_t*)iov->iov_base, iov->iov_len, 0);
+#else
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = iovcnt;
+
+	int rc = sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+	if(rc == -1 && sockerror() == ENOTSOCK) {
+		rc = ::writev(fd, iov, iovcnt);
+	}
+
+	return rc;
+#endif
+}
+
 char *xvdr_inet_ntoa(in6_addr addr)
 {
 	static char buff[INET6_ADDRSTRLEN];
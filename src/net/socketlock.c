@@ -1,12 +1,70 @@
 #include "socketlock.h"
 
-cSocketMutex cSocketLock::m_sockets;
+std::map<int, cSocketMutex> cSocketLock::m_sockets;
+pthread_mutex_t cSocketLock::m_socketsLock = PTHREAD_MUTEX_INITIALIZER;
 
-void cSocketLock::erase(int sock) {
-  cSocketMutex::iterator i = m_sockets.find(sock);
+cSocketMutex::cSocketMutex() : m_locked(false) {
+  pthread_mutex_init(&m_mutex, NULL);
+  pthread_cond_init(&m_cond, NULL);
+}
+
+cSocketMutex::cSocketMutex(const cSocketMutex& m) : m_locked(false) {
+  pthread_mutex_init(&m_mutex, NULL);
+  pthread_cond_init(&m_cond, NULL);
+}
+
+cSocketMutex::~cSocketMutex() {
+  pthread_cond_destroy(&m_cond);
+  pthread_mutex_destroy(&m_mutex);
+}
+
+void cSocketMutex::Lock() {
+  pthread_mutex_lock(&m_mutex);
 
-  if(i == m_sockets.end())
-    return;
+  while(m_locked)
+    pthread_cond_wait(&m_cond, &m_mutex);
+
+  m_locked = true;
+  pthread_mutex_unlock(&m_mutex);
+}
+
+bool cSocketMutex::TryLock() {
+  pthread_mutex_lock(&m_mutex);
+
+  bool rc = !m_locked;
+  m_locked = true;
+
+  pthread_mutex_unlock(&m_mutex);
+  return rc;
+}
 
+void cSocketMutex::Unlock() {
+  pthread_mutex_lock(&m_mutex);
+
+  m_locked = false;
+  pthread_cond_signal(&m_cond);
+
+  pthread_mutex_unlock(&m_mutex);
+}
+
+cSocketMutex* cSocketLock::get(int sock) {
+  pthread_mutex_lock(&m_socketsLock);
+  cSocketMutex* m = &m_sockets[sock];
+  pthread_mutex_unlock(&m_socketsLock);
+
+  return m;
+}
+
+bool cSocketLock::TryLock(int sock) {
+  return get(sock)->TryLock();
+}
+
+void cSocketLock::Unlock(int sock) {
+  get(sock)->Unlock();
+}
+
+void cSocketLock::erase(int sock) {
+  pthread_mutex_lock(&m_socketsLock);
   m_sockets.erase(sock);
+  pthread_mutex_unlock(&m_socketsLock);
 }
@@ -2,22 +2,66 @@
 #define XVDR_SOCKETLOCK_H
 
 #include <map>
-#include <vdr/thread.h>
+#include <pthread.h>
 
-class cSocketMutex : public std::map<int, cMutex> {
+// Serializes the packets written into a socket. The lock isn't owned by a
+// thread, a packet may be started by one thread and finished by another one
+// (see cLiveSender).
+
+class cSocketMutex {
+public:
+
+  cSocketMutex();
+
+  // std::map copies the initial value only
+  cSocketMutex(const cSocketMutex& m);
+
+  ~cSocketMutex();
+
+  void Lock();
+
+  bool TryLock();
+
+  void Unlock();
+
+private:
+
+  cSocketMutex& operator=(const cSocketMutex& m);
+
+  pthread_mutex_t m_mutex;
+
+  pthread_cond_t m_cond;
+
+  bool m_locked;
 };
 
-class cSocketLock : public cMutexLock {
+class cSocketLock {
 public:
 
-  cSocketLock(int sock) : cMutexLock(&m_sockets[sock]) {
+  cSocketLock(int sock) : m_mutex(get(sock)) {
+    m_mutex->Lock();
+  }
+
+  ~cSocketLock() {
+    m_mutex->Unlock();
   }
 
+  // lock without waiting (and without a cSocketLock object)
+  static bool TryLock(int sock);
+
+  static void Unlock(int sock);
+
   static void erase(int sock);
 
 private:
 
-  static cSocketMutex m_sockets;
+  static cSocketMutex* get(int sock);
+
+  cSocketMutex* m_mutex;
+
+  static std::map<int, cSocketMutex> m_sockets;
+
+  static pthread_mutex_t m_socketsLock;
 
 };
 
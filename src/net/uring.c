@@ -0,0 +1,228 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "os-config.h"
+#include "uring.h"
+
+#ifdef HAVE_LIBURING
+
+// entries per ring (a send request and its timeout)
+#define URING_ENTRIES 8
+
+// 0 = not probed yet, 1 = supported, -1 = not supported
+static volatile int uringstate = 0;
+
+static volatile bool uringenabled = true;
+
+static pthread_key_t uringkey;
+
+static pthread_once_t uringonce = PTHREAD_ONCE_INIT;
+
+static void uring_thread_exit(void* data) {
+	struct io_uring* ring = (struct io_uring*)data;
+
+	io_uring_queue_exit(ring);
+	free(ring);
+}
+
+static void uring_init() {
+	pthread_key_create(&uringkey, uring_thread_exit);
+}
+
+static bool uring_probe(struct io_uring* ring) {
+	struct io_uring_probe* probe = io_uring_get_probe_ring(ring);
+
+	if(probe == NULL) {
+		return false;
+	}
+
+	bool rc = io_uring_opcode_supported(probe, IORING_OP_SENDMSG) && io_uring_opcode_supported(probe, IORING_OP_LINK_TIMEOUT);
+	io_uring_free_probe(probe);
+
+	return rc;
+}
+
+// disable io_uring for the whole process (requests already queued in the ring are lost)
+static void uring_fail(struct io_uring* ring) {
+	uringstate = -1;
+	pthread_setspecific(uringkey, NULL);
+	uring_thread_exit(ring);
+}
+
+// every thread gets its own ring, so the rings don't need locking
+static struct io_uring* uring_ring() {
+	if(!uringenabled || uringstate < 0) {
+		return NULL;
+	}
+
+	pthread_once(&uringonce, uring_init);
+
+	struct io_uring* ring = (struct io_uring*)pthread_getspecific(uringkey);
+
+	if(ring != NULL) {
+		return ring;
+	}
+
+	ring = (struct io_uring*)calloc(1, sizeof(struct io_uring));
+
+	if(ring == NULL) {
+		return NULL;
+	}
+
+	// fails on kernels without io_uring (or if it has been disabled)
+	if(io_uring_queue_init(URING_ENTRIES, ring, 0) < 0) {
+		uringstate = -1;
+		free(ring);
+		return NULL;
+	}
+
+	if(uringstate == 0) {
+		uringstate = uring_probe(ring) ? 1 : -1;
+	}
+
+	if(uringstate < 0) {
+		uring_thread_exit(ring);
+		return NULL;
+	}
+
+	pthread_setspecific(uringkey, ring);
+	return ring;
+}
+
+bool uring_supported() {
+	return (uring_ring() != NULL);
+}
+
+void uring_enable(bool enable) {
+	uringenabled = enable;
+}
+
+int uring_writev(int fd, struct iovec* iov, int iovcnt, int timeout_ms) {
+	struct io_uring* ring = uring_ring();
+
+	if(ring == NULL) {
+		return -1;
+	}
+
+	// skip empty vectors
+	while(iovcnt > 0 && iov->iov_len == 0) {
+		iov++;
+		iovcnt--;
+	}
+
+	bool sent = false;
+
+	while(iovcnt > 0) {
+		struct msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = iovcnt;
+
+		struct __kernel_timespec ts;
+		ts.tv_sec = timeout_ms / 1000;
+		ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+
+		// the kernel waits for socket space itself, no poll() needed
+		struct io_uring_sqe* sqe = io_uring_get_sqe(ring);
+		io_uring_prep_sendmsg(sqe, fd, &msg, MSG_NOSIGNAL | MSG_WAITALL);
+		io_uring_sqe_set_data(sqe, &msg);
+		sqe->flags |= IOSQE_IO_LINK;
+
+		sqe = io_uring_get_sqe(ring);
+		io_uring_prep_link_timeout(sqe, &ts, 0);
+		io_uring_sqe_set_data(sqe, NULL);
+
+		// submit both requests and wait for the completions in one go
+		int rc = io_uring_submit_and_wait(ring, 2);
+
+		if(rc < 0 && rc != -EINTR) {
+			uring_fail(ring);
+			return sent ? -rc : -1;
+		}
+
+		int result = -ECANCELED;
+
+		for(int completed = 0; completed < 2;) {
+			struct io_uring_cqe* cqe = NULL;
+			rc = io_uring_wait_cqe(ring, &cqe);
+
+			if(rc == -EINTR) {
+				continue;
+			}
+
+			if(rc < 0) {
+				uring_fail(ring);
+				return sent ? -rc : -1;
+			}
+
+			if(io_uring_cqe_get_data(cqe) != NULL) {
+				result = cqe->res;
+			}
+
+			io_uring_cqe_seen(ring, cqe);
+			completed++;
+		}
+
+		// pipes and files take the writev() path
+		if(!sent && (result == -ENOTSOCK || result == -EINVAL || result == -EOPNOTSUPP)) {
+			return -1;
+		}
+
+		if(result == -EINTR || result == -EAGAIN) {
+			continue;
+		}
+
+		// cancelled by the linked timeout
+		if(result == -ECANCELED) {
+			return ETIMEDOUT;
+		}
+
+		if(result < 0) {
+			return -result;
+		}
+
+		if(result == 0) {
+			return ECONNRESET;
+		}
+
+		// advance vectors on partial writes
+		size_t written = result;
+		sent = true;
+
+		while(iovcnt > 0 && written >= iov->iov_len) {
+			written -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+
+		if(iovcnt > 0) {
+			iov->iov_base = (uint8_t*)iov->iov_base + written;
+			iov->iov_len -= written;
+		}
+	}
+
+	return 0;
+}
+
+#else
+
+bool uring_supported() {
+	return false;
+}
+
+void uring_enable(bool enable) {
+}
+
+int uring_writev(int fd, struct iovec* iov, int iovcnt, int timeout_ms) {
+	return -1;
+}
+
+#endif // HAVE_LIBURING
@@ -0,0 +1,43 @@
+/** \file uring.h
+	Header file for the io_uring transmit backend.
+	This include file defines the functions used to send packets through io_uring
+*/
+
+#ifndef URING_H
+#define URING_H
+
+struct iovec;
+
+/**
+	Check io_uring support.
+	Returns true if the plugin has been built with liburing and the running
+	kernel supports everything needed (sendmsg and linked timeouts).
+
+	@return true if io_uring can be used
+*/
+bool uring_supported();
+
+/**
+	Enable or disable the io_uring backend at runtime.
+	If disabled, all packets are sent with poll() / sendmsg().
+
+	@param	enable	true to use io_uring if supported
+*/
+void uring_enable(bool enable);
+
+/**
+	Write vectors to a socket.
+	Submits a sendmsg request with a linked timeout to the ring of the calling
+	thread and waits for both completions with a single system call.
+	Partial writes are resubmitted. The vectors are modified.
+
+	@param	fd			filedescriptor of the socket
+	@param	iov			vectors to send
+	@param	iovcnt		number of vectors
+	@param	timeout_ms	timeout in milliseconds
+	@return 0 on success, an errno value on failure or -1 if nothing has been sent
+			and the caller should use the poll() / sendmsg() path
+*/
+int uring_writev(int fd, struct iovec* iov, int iovcnt, int timeout_ms);
+
+#endif // URING_H
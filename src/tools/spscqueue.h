@@ -0,0 +1,233 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef XVDR_SPSCQUEUE_H
+#define XVDR_SPSCQUEUE_H
+
+#include <stdint.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+
+#define XVDR_CACHELINE 64
+
+// Bounded lock-free queue for exactly one producer and one consumer thread.
+// The consumer may park in Wait(), the producer only signals the eventfd
+// if the consumer is actually parked.
+
+template<class T> class cSPSCQueue
+{
+public:
+
+  cSPSCQueue(uint32_t size) : m_mask(0)
+  {
+    // round up to a power of two
+    uint32_t s = 2;
+    while(s < size)
+      s <<= 1;
+
+    m_mask = s - 1;
+    m_items = new T[s];
+
+    m_head.index = 0;
+    m_tail.index = 0;
+    m_parked = 0;
+    m_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  }
+
+  ~cSPSCQueue()
+  {
+    if(m_fd != -1)
+      close(m_fd);
+
+    delete[] m_items;
+  }
+
+  // producer: add an item, returns false if the queue is full
+  bool Push(const T& item)
+  {
+    uint32_t tail = m_tail.index;
+
+    if(tail - m_head.index > m_mask)
+      return false;
+
+    m_items[tail & m_mask] = item;
+
+    // publish the item, then check if the consumer sleeps
+    __sync_synchronize();
+    m_tail.index = tail + 1;
+    __sync_synchronize();
+
+    if(m_parked)
+      Wakeup();
+
+    return true;
+  }
+
+  // consumer: remove the oldest item, returns false if the queue is empty
+  bool Pop(T& item)
+  {
+    uint32_t head = m_head.index;
+
+    if(head == m_tail.index)
+      return false;
+
+    __sync_synchronize();
+    item = m_items[head & m_mask];
+    __sync_synchronize();
+
+    m_head.index = head + 1;
+    return true;
+  }
+
+  // consumer: oldest item without removing it
+  bool Front(T& item)
+  {
+    uint32_t head = m_head.index;
+
+    if(head == m_tail.index)
+      return false;
+
+    __sync_synchronize();
+    item = m_items[head & m_mask];
+    return true;
+  }
+
+  uint32_t Size() const
+  {
+    return m_tail.index - m_head.index;
+  }
+
+  // sequence number of the oldest item (consumer)
+  uint32_t Head() const
+  {
+    return m_head.index;
+  }
+
+  // sequence number the next pushed item will get (producer)
+  uint32_t Tail() const
+  {
+    return m_tail.index;
+  }
+
+  uint32_t Capacity() const
+  {
+    return m_mask + 1;
+  }
+
+  bool Empty() const
+  {
+    return (Size() == 0);
+  }
+
+  // consumer: park until an item has been pushed, Wakeup() or timeout
+  bool Wait(int timeout_ms)
+  {
+    m_parked = 1;
+    __sync_synchronize();
+
+    // recheck, the producer may have missed the flag
+    if(Empty())
+      Sleep(timeout_ms);
+
+    m_parked = 0;
+    return !Empty();
+  }
+
+  // consumer: sleep without being woken by new items (Wakeup() still works)
+  void Sleep(int timeout_ms)
+  {
+    struct pollfd p;
+    p.fd = m_fd;
+    p.events = POLLIN;
+    p.revents = 0;
+
+    if(poll(&p, 1, timeout_ms) > 0)
+    {
+      eventfd_t value;
+      eventfd_read(m_fd, &value);
+    }
+  }
+
+  // wake the consumer (any thread)
+  void Wakeup()
+  {
+    eventfd_write(m_fd, 1);
+  }
+
+  // consumer driven by an event loop: get woken through Fd() when an item
+  // is pushed. Returns false if there is one already.
+  bool Park()
+  {
+    m_parked = 1;
+    __sync_synchronize();
+
+    if(Empty())
+      return true;
+
+    m_parked = 0;
+    return false;
+  }
+
+  void Unpark()
+  {
+    m_parked = 0;
+  }
+
+  // consumer: reset the wakeup signal
+  void Acknowledge()
+  {
+    eventfd_t value;
+    eventfd_read(m_fd, &value);
+  }
+
+  // becomes readable on wakeups
+  int Fd() const
+  {
+    return m_fd;
+  }
+
+private:
+
+  struct Index
+  {
+    volatile uint32_t index;
+    char padding[XVDR_CACHELINE - sizeof(uint32_t)];
+  };
+
+  // consumer and producer index on separate cache lines
+  Index m_head;
+
+  Index m_tail;
+
+  volatile int m_parked;
+
+  int m_fd;
+
+  uint32_t m_mask;
+
+  T* m_items;
+};
+
+#endif // XVDR_SPSCQUEUE_H
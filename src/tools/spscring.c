@@ -0,0 +1,207 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+
+#include "spscring.h"
+
+cSPSCRing::cSPSCRing(uint32_t size, uint32_t unit) : m_parked(0), m_threshold(1), m_deadline(0), m_oldest(0), m_overflows(0), m_overflowBytes(0)
+{
+  if(unit == 0)
+    unit = 1;
+
+  // whole units only
+  m_size = ((size + unit - 1) / unit) * unit;
+  m_buffer = new uint8_t[m_size];
+
+  m_head.index = 0;
+  m_tail.index = 0;
+  m_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+}
+
+cSPSCRing::~cSPSCRing()
+{
+  if(m_fd != -1)
+    close(m_fd);
+
+  delete[] m_buffer;
+}
+
+uint64_t cSPSCRing::Now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+bool cSPSCRing::Put(const uint8_t* data, uint32_t length)
+{
+  uint32_t tail = m_tail.index;
+  uint32_t used = Distance(m_head.index, tail);
+
+  if(length > m_size - used)
+  {
+    m_overflows++;
+    m_overflowBytes += length;
+    return false;
+  }
+
+  // copy (in two parts if the data wraps)
+  uint32_t offset = (tail < m_size) ? tail : tail - m_size;
+  uint32_t first = m_size - offset;
+
+  if(first >= length)
+    memcpy(m_buffer + offset, data, length);
+  else
+  {
+    memcpy(m_buffer + offset, data, first);
+    memcpy(m_buffer, data + first, length - first);
+  }
+
+  // publish the data, then check if the consumer sleeps
+  __sync_synchronize();
+  m_tail.index = Advance(tail, length);
+  __sync_synchronize();
+
+  // only the consumer empties the ring, so the data is as old as the first put into an empty ring
+  if(used == 0)
+    m_oldest = Now();
+
+  if(!m_parked)
+    return true;
+
+  // a consumer parked on an empty ring waits for the idle timeout, it must
+  // start the deadline now
+  if(used == 0 || used + length >= m_threshold || (int)(Now() - m_oldest) >= m_deadline)
+    Wakeup();
+
+  return true;
+}
+
+uint8_t* cSPSCRing::Get(uint32_t& length)
+{
+  uint32_t head = m_head.index;
+  uint32_t available = Distance(head, m_tail.index);
+
+  if(available == 0)
+  {
+    length = 0;
+    return NULL;
+  }
+
+  __sync_synchronize();
+
+  // contiguous part only
+  uint32_t offset = (head < m_size) ? head : head - m_size;
+  length = m_size - offset;
+
+  if(length > available)
+    length = available;
+
+  return m_buffer + offset;
+}
+
+void cSPSCRing::Del(uint32_t length)
+{
+  __sync_synchronize();
+  m_head.index = Advance(m_head.index, length);
+}
+
+void cSPSCRing::Clear()
+{
+  __sync_synchronize();
+  m_head.index = m_tail.index;
+}
+
+bool cSPSCRing::Wait(int timeout_ms)
+{
+  m_parked = 1;
+  __sync_synchronize();
+
+  bool pending = false;
+
+  // recheck, the producer may have missed the flag
+  while(Available() < m_threshold)
+  {
+    // data below the threshold is picked up at the deadline at the latest
+    if(Available() > 0)
+    {
+      if(pending)
+        break;
+
+      pending = true;
+
+      if(m_deadline < timeout_ms)
+        timeout_ms = m_deadline;
+    }
+
+    struct pollfd p;
+    p.fd = m_fd;
+    p.events = POLLIN;
+    p.revents = 0;
+
+    if(poll(&p, 1, timeout_ms) <= 0)
+      break;
+
+    eventfd_t value;
+    eventfd_read(m_fd, &value);
+
+    // Wakeup() without data
+    if(Available() == 0)
+      break;
+  }
+
+  m_parked = 0;
+  return (Available() > 0);
+}
+
+uint32_t cSPSCRing::Available() const
+{
+  return Distance(m_head.index, m_tail.index);
+}
+
+void cSPSCRing::Wakeup()
+{
+  eventfd_write(m_fd, 1);
+}
+
+void cSPSCRing::SetThreshold(uint32_t bytes)
+{
+  if(bytes == 0)
+    bytes = 1;
+
+  if(bytes > m_size)
+    bytes = m_size;
+
+  m_threshold = bytes;
+}
+
+void cSPSCRing::SetDeadline(int ms)
+{
+  m_deadline = ms;
+}
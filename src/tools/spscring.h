@@ -0,0 +1,132 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef XVDR_SPSCRING_H
+#define XVDR_SPSCRING_H
+
+#include <stdint.h>
+
+#include "spscqueue.h"
+
+// Lock-free byte ring for exactly one producer and one consumer thread.
+// Data is stored in whole units (e.g. TS packets), the capacity is a
+// multiple of the unit size, so every chunk returned by Get() starts at a
+// unit boundary. The producer only wakes a parked consumer if enough data
+// is waiting (threshold) or the oldest byte waits too long (deadline).
+// The first data put into an empty ring wakes it too, so it waits for the
+// deadline instead of its idle timeout.
+
+class cSPSCRing
+{
+public:
+
+  cSPSCRing(uint32_t size, uint32_t unit = 1);
+
+  ~cSPSCRing();
+
+  // producer: store "length" bytes (a multiple of the unit size).
+  // Returns false and counts an overflow if they don't fit.
+  bool Put(const uint8_t* data, uint32_t length);
+
+  // consumer: readable data up to the end of the buffer (NULL if empty)
+  uint8_t* Get(uint32_t& length);
+
+  // consumer: release data returned by Get()
+  void Del(uint32_t length);
+
+  // consumer: drop all data
+  void Clear();
+
+  // consumer: park until the threshold or the deadline is reached,
+  // Wakeup() is called or "timeout_ms" passed. Returns true if there is data.
+  bool Wait(int timeout_ms);
+
+  // wake the consumer (any thread)
+  void Wakeup();
+
+  // bytes to collect before the consumer is woken
+  void SetThreshold(uint32_t bytes);
+
+  // maximum ms the oldest byte waits for the consumer
+  void SetDeadline(int ms);
+
+  uint32_t Available() const;
+
+  uint32_t Capacity() const { return m_size; }
+
+  uint32_t Threshold() const { return m_threshold; }
+
+  // failed Put() calls and the bytes lost
+  uint32_t Overflows() const { return m_overflows; }
+
+  uint64_t OverflowBytes() const { return m_overflowBytes; }
+
+private:
+
+  static uint64_t Now();
+
+  // positions run from 0 to 2 * m_size - 1, so a full ring can be told from an empty one
+  uint32_t Advance(uint32_t index, uint32_t length) const
+  {
+    index += length;
+    return (index >= 2 * m_size) ? index - 2 * m_size : index;
+  }
+
+  uint32_t Distance(uint32_t head, uint32_t tail) const
+  {
+    return (tail >= head) ? tail - head : tail + 2 * m_size - head;
+  }
+
+  struct Index
+  {
+    volatile uint32_t index;
+    char padding[XVDR_CACHELINE - sizeof(uint32_t)];
+  };
+
+  // consumer and producer position on separate cache lines
+  Index m_head;
+
+  Index m_tail;
+
+  volatile int m_parked;
+
+  int m_fd;
+
+  uint8_t* m_buffer;
+
+  uint32_t m_size;
+
+  volatile uint32_t m_threshold;
+
+  volatile int m_deadline;
+
+  // producer: arrival of the oldest unread byte (ms)
+  uint64_t m_oldest;
+
+  volatile uint32_t m_overflows;
+
+  volatile uint64_t m_overflowBytes;
+};
+
+#endif // XVDR_SPSCRING_H
@@ -26,6 +26,9 @@
 #include <getopt.h>
 #include <vdr/plugin.h>
 #include "xvdr.h"
+#include "live/livehub.h"
+#include "live/livesession.h"
+#include "live/timeshiftspace.h"
 
 cPluginXVDRServer::cPluginXVDRServer(void)
 {
@@ -126,13 +129,33 @@ bool cPluginXVDRServer::Service(const char *Id, void *Data)
 
 const char **cPluginXVDRServer::SVDRPHelpPages(void)
 {
-  // Return help text for SVDRP commands this plugin implements
-  return NULL;
+  static const char *HelpPages[] =
+  {
+    "TSHF\n"
+    "    Show the disk and memory usage of the timeshift buffers.",
+    "LIVE\n"
+    "    Show the shared receivers and the live sessions with their bitrate,\n"
+    "    receive buffer and overflows.",
+    NULL
+  };
+
+  return HelpPages;
 }
 
 cString cPluginXVDRServer::SVDRPCommand(const char *Command, const char *Option, int &ReplyCode)
 {
-  // Process SVDRP commands this plugin implements
+  if(strcasecmp(Command, "TSHF") == 0)
+  {
+    ReplyCode = 250;
+    return cTimeShiftSpace::Status();
+  }
+
+  if(strcasecmp(Command, "LIVE") == 0)
+  {
+    ReplyCode = 250;
+    return cString::sprintf("%s%s", (const char*)cLiveHub::Status(), (const char*)cLiveSession::Status());
+  }
+
   return NULL;
 }
 
@@ -42,7 +42,10 @@
 
 #include "config/config.h"
 #include "live/livestreamer.h"
+#include "live/timeshiftstore.h"
 #include "net/msgpacket.h"
+#include "net/msgreader.h"
+#include "net/msgstringtable.h"
 #include "net/socketlock.h"
 #include "recordings/recordingscache.h"
 #include "recordings/recplayer.h"
@@ -116,6 +119,65 @@ cString cXVDRClient::CreateLogoURL(cChannel* channel)
   return url;
 }
 
+int cXVDRClient::GetCodec(uint16_t opcode)
+{
+  // a stream with the window of previous responses beats all others
+  if(m_codecs & (1 << MsgPacket::CodecZlibStream))
+    return MsgPacket::CodecZlibStream;
+
+  int codec = MsgPacket::CodecZlib;
+
+  // huge EPG responses compress best with zstd, lists should be fast
+  if(opcode >= XVDR_EPG_GETFORCHANNEL && opcode < XVDR_SCAN_SUPPORTED)
+    codec = MsgPacket::CodecZstd;
+  else if(opcode >= XVDR_CHANNELS_GETCOUNT && opcode < XVDR_EPG_GETFORCHANNEL)
+    codec = MsgPacket::CodecLZ4;
+
+  // fall back to zlib if the client doesn't support it
+  if(!(m_codecs & (1 << codec)))
+    codec = MsgPacket::CodecZlib;
+
+  return codec;
+}
+
+void cXVDRClient::CompressResponse()
+{
+  int codec = GetCodec(m_req->getMsgID());
+
+  // the response must be sent after this (compressor state)
+  if(codec == MsgPacket::CodecZlibStream)
+    m_compressor.compress(m_resp);
+  else
+    m_resp->compress(m_compressionLevel, codec);
+}
+
+void cXVDRClient::PutListValue(uint32_t value)
+{
+  if(m_features & XVDR_FEATURE_COMPACTLISTS)
+    m_resp->put_Varint(value);
+  else
+    m_resp->put_U32(value);
+}
+
+void cXVDRClient::PutListTime(time_t& previous, time_t value)
+{
+  // compact lists store the difference to the previous entry
+  if(m_features & XVDR_FEATURE_COMPACTLISTS)
+    m_resp->put_SVarint((int64_t)value - (int64_t)previous);
+  else
+    m_resp->put_U32(value);
+
+  previous = value;
+}
+
+void cXVDRClient::PutListString(MsgStringTable& strings, const char* value)
+{
+  if(m_features & XVDR_FEATURE_COMPACTLISTS)
+    strings.put(m_resp, value);
+  else
+    m_resp->put_String(value);
+}
+
 void cXVDRClient::PutTimer(cTimer* timer, MsgPacket* p)
 {
   Channels.Lock(false);
@@ -233,12 +295,15 @@ cXVDRClient::cXVDRClient(int fd, unsigned int id)
   m_processSCAN_Response    = NULL;
   m_processSCAN_Socket      = -1;
   m_compressionLevel        = 0;
+  m_codecs                  = (1 << MsgPacket::CodecZlib);
+  m_features                = 0;
   m_LanguageIndex           = -1;
   m_LangStreamType          = stMPEG2AUDIO;
   m_channelCount            = 0;
   m_timeout                 = 3000;
 
   m_socket = fd;
+  m_reader = new MsgReader(fd);
   m_wantfta = true;
   m_filterlanguage = false;
 
@@ -259,6 +324,7 @@ cXVDRClient::~cXVDRClient()
 
   // close connection
   close(m_socket);
+  delete m_reader;
   DEBUGLOG("done");
 }
 
@@ -270,7 +336,7 @@ void cXVDRClient::Action(void)
 
   while (Running())
   {
-    m_req = MsgPacket::read(m_socket, bClosed, 2000);
+    m_req = m_reader->read(bClosed, 2000);
 
     if(bClosed)
     {
@@ -281,6 +347,11 @@ void cXVDRClient::Action(void)
 
     if(m_req != NULL)
     {
+      uint32_t skipped = m_reader->skippedBytes();
+
+      if(skipped > 0)
+        ERRORLOG("lost sync with the client, %u bytes skipped", skipped);
+
       processRequest();
       delete m_req;
     }
@@ -291,11 +362,18 @@ void cXVDRClient::Action(void)
   StopChannelStreaming();
 }
 
-bool cXVDRClient::StartChannelStreaming(const cChannel *channel, uint32_t timeout, int32_t priority)
+bool cXVDRClient::StartChannelStreaming(const cChannel *channel, uint32_t timeout, int32_t priority, int profile)
 {
   cMutexLock lock(&m_switchLock);
   m_Streamer = new cLiveStreamer(timeout);
   m_Streamer->SetLanguage(m_LanguageIndex, m_LangStreamType);
+  m_Streamer->SetProfile(profile);
+
+  if(m_features & XVDR_FEATURE_NOHEADERCHECKSUM)
+    m_Streamer->DisableCheckSum();
+
+  if(m_features & XVDR_FEATURE_QUEUESTATUS)
+    m_Streamer->EnableQueueStatus();
 
   return m_Streamer->StreamChannel(channel, priority, m_socket, m_resp);
 }
@@ -519,6 +597,9 @@ bool cXVDRClient::processRequest()
   m_resp = new MsgPacket(m_req->getMsgID(), XVDR_CHANNEL_REQUEST_RESPONSE, m_req->getUID());
   m_resp->setProtocolVersion(XVDR_PROTOCOLVERSION);
 
+  if(m_features & XVDR_FEATURE_NOHEADERCHECKSUM)
+    m_resp->disableCheckSum();
+
   bool result = false;
   switch(m_req->getMsgID())
   {
@@ -564,6 +645,18 @@ bool cXVDRClient::processRequest()
       result = processChannelStream_Pause();
       break;
 
+    case XVDR_CHANNELSTREAM_SEEK:
+      result = processChannelStream_Seek();
+      break;
+
+    case XVDR_CHANNELSTREAM_RANGE:
+      result = processChannelStream_Range();
+      break;
+
+    case XVDR_CHANNELSTREAM_KEYFRAME:
+      result = processChannelStream_KeyFrame();
+      break;
+
 
     /** OPCODE 40 - 59: XVDR network functions for recording streaming */
     case XVDR_RECSTREAM_OPEN:
@@ -723,9 +816,13 @@ bool cXVDRClient::process_Login() /* OPCODE 1 */
 {
   m_protocolVersion      = m_req->getProtocolVersion();
   m_compressionLevel     = m_req->get_U8();
+  m_compressor.setLevel(m_compressionLevel);
   const char *clientName = m_req->get_String();
   const char *language   = NULL;
 
+  bool codecs            = false;
+  bool features          = false;
+
   // get preferred language
   if(!m_req->eop())
   {
@@ -734,12 +831,30 @@ bool cXVDRClient::process_Login() /* OPCODE 1 */
     m_LangStreamType = (eStreamType)m_req->get_U8();
   }
 
+  // get supported payload codecs (zlib if not sent)
+  if(!m_req->eop())
+  {
+    m_codecs = m_req->get_U32() & MsgPacket::getCodecs();
+    codecs = true;
+  }
+
+  // get requested protocol features
+  if(!m_req->eop())
+  {
+    m_features = m_req->get_U32() & XVDR_FEATURES;
+    features = true;
+  }
+
   if (m_protocolVersion > XVDR_PROTOCOLVERSION || m_protocolVersion < 4)
   {
     ERRORLOG("Client '%s' has unsupported protocol version '%u', terminating client", clientName, m_protocolVersion);
     return false;
   }
 
+  // compact lists are a protocol version 5 encoding
+  if(m_protocolVersion < 5)
+    m_features &= ~XVDR_FEATURE_COMPACTLISTS;
+
   INFOLOG("Welcome client '%s' with protocol version '%u'", clientName, m_protocolVersion);
 
   if(!m_LanguageIndex != -1) {
@@ -756,6 +871,24 @@ bool cXVDRClient::process_Login() /* OPCODE 1 */
   m_resp->put_String("VDR-XVDR Server");
   m_resp->put_String(XVDR_VERSION);
 
+  // acknowledge the codecs we will use
+  if(codecs)
+  {
+    INFOLOG("Payload codecs: 0x%02X", m_codecs);
+    m_resp->put_U32(m_codecs);
+  }
+
+  // acknowledge the features we support
+  if(features)
+  {
+    INFOLOG("Protocol features: 0x%08X", m_features);
+    m_resp->put_U32(m_features);
+  }
+
+  // the login request was the last one with a header checksum
+  if(m_features & XVDR_FEATURE_NOHEADERCHECKSUM)
+    m_reader->acceptNoCheckSum();
+
   SetLoggedIn(true);
   return true;
 }
@@ -850,11 +983,16 @@ bool cXVDRClient::processChannelStream_Open() /* OPCODE 20 */
 
   uint32_t uid = m_req->get_U32();
   int32_t priority = 50;
+  int profile = XVDR_STREAM_PROFILE_LOWLATENCY;
 
   if(!m_req->eop()) {
     priority = m_req->get_S32();
   }
 
+  if(!m_req->eop()) {
+    profile = m_req->get_U8();
+  }
+
   uint32_t timeout = XVDRServerConfig.stream_timeout;
 
   StopChannelStreaming();
@@ -877,9 +1015,9 @@ bool cXVDRClient::processChannelStream_Open() /* OPCODE 20 */
   }
   else
   {
-    if (StartChannelStreaming(channel, timeout, priority))
+    if (StartChannelStreaming(channel, timeout, priority, profile))
     {
-      INFOLOG("Started streaming of channel %s (timeout %i seconds, priority %i)", channel->Name(), timeout, priority);
+      INFOLOG("Started streaming of channel %s (timeout %i seconds, priority %i, profile %i)", channel->Name(), timeout, priority, profile);
       // return here without sending the response
       // (was already done in cLiveStreamer::StreamChannel)
       return false;
@@ -909,9 +1047,79 @@ bool cXVDRClient::processChannelStream_Request() /* OPCODE 22 */
 bool cXVDRClient::processChannelStream_Pause() /* OPCODE 23 */
 {
   bool on = m_req->get_U32();
+  bool spill = false;
+
+  // keep the timeshift buffer on disk
+  if(!m_req->eop())
+    spill = m_req->get_U8();
+
   INFOLOG("LIVESTREAM: %s", on ? "PAUSED" : "TIMESHIFT");
 
-  m_Streamer->Pause(on);
+  m_Streamer->Pause(on, spill);
+
+  return true;
+}
+
+bool cXVDRClient::processChannelStream_Seek() /* OPCODE 24 */
+{
+  bool relative = m_req->get_U8();
+  int64_t time = m_req->get_S64();
+
+  sTimeShiftPosition pos;
+
+  if(m_Streamer == NULL || !m_Streamer->Seek(time, relative, pos))
+  {
+    m_resp->put_U32(XVDR_RET_DATAUNKNOWN);
+    return true;
+  }
+
+  DEBUGLOG("Timeshift seek (%s %lli ms): pts %lli", relative ? "relative" : "absolute", (long long)time, (long long)pos.pts);
+
+  m_resp->put_U32(XVDR_RET_OK);
+  m_resp->put_S64(pos.pts);
+  m_resp->put_S64(pos.time);
+
+  return true;
+}
+
+bool cXVDRClient::processChannelStream_Range() /* OPCODE 25 */
+{
+  sTimeShiftPosition first;
+  sTimeShiftPosition last;
+  sTimeShiftPosition current;
+
+  if(m_Streamer == NULL || !m_Streamer->GetTimeShiftRange(first, last, current))
+  {
+    m_resp->put_U32(XVDR_RET_DATAUNKNOWN);
+    return true;
+  }
+
+  m_resp->put_U32(XVDR_RET_OK);
+  m_resp->put_S64(first.time);
+  m_resp->put_S64(last.time);
+  m_resp->put_S64(current.time);
+  m_resp->put_S64(first.pts);
+  m_resp->put_S64(last.pts);
+  m_resp->put_S64(current.pts);
+
+  return true;
+}
+
+bool cXVDRClient::processChannelStream_KeyFrame() /* OPCODE 26 */
+{
+  bool forward = (m_req->get_S32() >= 0);
+
+  sTimeShiftPosition pos;
+
+  if(m_Streamer == NULL || !m_Streamer->NextKeyFrame(forward, pos))
+  {
+    m_resp->put_U32(XVDR_RET_DATAUNKNOWN);
+    return true;
+  }
+
+  m_resp->put_U32(XVDR_RET_OK);
+  m_resp->put_S64(pos.pts);
+  m_resp->put_S64(pos.time);
 
   return true;
 }
@@ -1088,23 +1296,30 @@ bool cXVDRClient::processCHANNELS_GetChannels() /* OPCODE 63 */
   m_channelCount = ChannelsCount();
   Channels.Lock(false);
 
+  MsgStringTable strings;
+
   for (cChannel *channel = Channels.First(); channel; channel = Channels.Next(channel))
   {
     if(!IsChannelWanted(channel, radio))
       continue;
 
-    m_resp->put_U32(channel->Number());
-    m_resp->put_String(m_toUTF8.Convert(channel->Name()));
+    PutListValue(channel->Number());
+    PutListString(strings, m_toUTF8.Convert(channel->Name()));
+
+    // provider - compact lists only
+    if(m_features & XVDR_FEATURE_COMPACTLISTS)
+      PutListString(strings, m_toUTF8.Convert(channel->Provider()));
+
     m_resp->put_U32(CreateChannelUID(channel));
-    m_resp->put_U32(channel->Ca());
+    PutListValue(channel->Ca());
 
     // logo url - for future use
-    m_resp->put_String((const char*)CreateLogoURL(channel));
+    PutListString(strings, (const char*)CreateLogoURL(channel));
   }
 
   Channels.Unlock();
 
-  m_resp->compress(m_compressionLevel);
+  CompressResponse();
 
   return true;
 }
@@ -1494,6 +1709,9 @@ bool cXVDRClient::processRECORDINGS_GetList() /* OPCODE 102 */
   cMutexLock lock(&m_timerLock);
   cRecordingsCache& reccache = cRecordingsCache::GetInstance();
 
+  MsgStringTable strings;
+  time_t previousStart = 0;
+
   for (cRecording *recording = Recordings.First(); recording; recording = Recordings.Next(recording))
   {
 #if APIVERSNUM >= 10705
@@ -1529,13 +1747,13 @@ bool cXVDRClient::processRECORDINGS_GetList() /* OPCODE 102 */
     DEBUGLOG("GRI: RC: recordingStart=%lu recordingDuration=%i", recordingStart, recordingDuration);
 
     // recording_time
-    m_resp->put_U32(recordingStart);
+    PutListTime(previousStart, recordingStart);
 
     // duration
-    m_resp->put_U32(recordingDuration);
+    PutListValue(recordingDuration);
 
     // priority
-    m_resp->put_U32(
+    PutListValue(
 #if APIVERSNUM >= 10727
     recording->Priority()
 #else
@@ -1544,7 +1762,7 @@ bool cXVDRClient::processRECORDINGS_GetList() /* OPCODE 102 */
     );
 
     // lifetime
-    m_resp->put_U32(
+    PutListValue(
 #if APIVERSNUM >= 10727
     recording->Lifetime()
 #else
@@ -1553,7 +1771,7 @@ bool cXVDRClient::processRECORDINGS_GetList() /* OPCODE 102 */
     );
 
     // channel_name
-    m_resp->put_String(recording->Info()->ChannelName() ? m_toUTF8.Convert(recording->Info()->ChannelName()) : "");
+    PutListString(strings, recording->Info()->ChannelName() ? m_toUTF8.Convert(recording->Info()->ChannelName()) : "");
 
     char* fullname = strdup(recording->Name());
     char* recname = strrchr(fullname, FOLDERDELIMCHAR);
@@ -1569,19 +1787,19 @@ bool cXVDRClient::processRECORDINGS_GetList() /* OPCODE 102 */
     }
 
     // title
-    m_resp->put_String(m_toUTF8.Convert(recname));
+    PutListString(strings, m_toUTF8.Convert(recname));
 
     // subtitle
     if (!isempty(recording->Info()->ShortText()))
-      m_resp->put_String(m_toUTF8.Convert(recording->Info()->ShortText()));
+      PutListString(strings, m_toUTF8.Convert(recording->Info()->ShortText()));
     else
-      m_resp->put_String("");
+      PutListString(strings, "");
 
     // description
     if (!isempty(recording->Info()->Description()))
-      m_resp->put_String(m_toUTF8.Convert(recording->Info()->Description()));
+      PutListString(strings, m_toUTF8.Convert(recording->Info()->Description()));
     else
-      m_resp->put_String("");
+      PutListString(strings, "");
 
     // directory
     if(directory != NULL) {
@@ -1594,33 +1812,41 @@ bool cXVDRClient::processRECORDINGS_GetList() /* OPCODE 102 */
       while(*directory == '/') directory++;
     }
 
-    m_resp->put_String((isempty(directory)) ? "" : m_toUTF8.Convert(directory));
+    PutListString(strings, (isempty(directory)) ? "" : m_toUTF8.Convert(directory));
 
-    // filename / uid of recording
+    // filename / uid of recording (plain uid in compact lists)
     uint32_t uid = cRecordingsCache::GetInstance().Register(recording);
-    char recid[9];
-    snprintf(recid, sizeof(recid), "%08x", uid);
-    m_resp->put_String(recid);
+
+    if(m_features & XVDR_FEATURE_COMPACTLISTS)
+    {
+      m_resp->put_U32(uid);
+    }
+    else
+    {
+      char recid[9];
+      snprintf(recid, sizeof(recid), "%08x", uid);
+      m_resp->put_String(recid);
+    }
 
     // playcount
-    m_resp->put_U32(reccache.GetPlayCount(uid));
+    PutListValue(reccache.GetPlayCount(uid));
 
     // content
     if(event != NULL)
-      m_resp->put_U32(event->Contents());
+      PutListValue(event->Contents());
     else
-      m_resp->put_U32(0);
+      PutListValue(0);
 
     // thumbnail url - for future use
-    m_resp->put_String("");
+    PutListString(strings, "");
 
     // icon url - for future use
-    m_resp->put_String("");
+    PutListString(strings, "");
 
     free(fullname);
   }
 
-  m_resp->compress(m_compressionLevel);
+  CompressResponse();
 
   return true;
 }
@@ -1758,7 +1984,7 @@ bool cXVDRClient::processEPG_GetForChannel() /* OPCODE 120 */
 
   if (!channel)
   {
-    m_resp->put_U32(0);
+    PutListValue(0);
     Channels.Unlock();
 
     ERRORLOG("written 0 because channel = NULL");
@@ -1769,7 +1995,7 @@ bool cXVDRClient::processEPG_GetForChannel() /* OPCODE 120 */
   const cSchedules *Schedules = cSchedules::Schedules(MutexLock);
   if (!Schedules)
   {
-    m_resp->put_U32(0);
+    PutListValue(0);
     Channels.Unlock();
 
     DEBUGLOG("written 0 because Schedule!s! = NULL");
@@ -1779,7 +2005,7 @@ bool cXVDRClient::processEPG_GetForChannel() /* OPCODE 120 */
   const cSchedule *Schedule = Schedules->GetSchedule(channel->GetChannelID());
   if (!Schedule)
   {
-    m_resp->put_U32(0);
+    PutListValue(0);
     Channels.Unlock();
 
     DEBUGLOG("written 0 because Schedule = NULL");
@@ -1788,6 +2014,9 @@ bool cXVDRClient::processEPG_GetForChannel() /* OPCODE 120 */
 
   bool atLeastOneEvent = false;
 
+  MsgStringTable strings;
+  time_t previousTime = 0;
+
   uint32_t thisEventID;
   uint32_t thisEventTime;
   uint32_t thisEventDuration;
@@ -1829,15 +2058,15 @@ bool cXVDRClient::processEPG_GetForChannel() /* OPCODE 120 */
     if (!thisEventSubTitle)     thisEventSubTitle     = "";
     if (!thisEventDescription)  thisEventDescription  = "";
 
-    m_resp->put_U32(thisEventID);
-    m_resp->put_U32(thisEventTime);
-    m_resp->put_U32(thisEventDuration);
-    m_resp->put_U32(thisEventContent);
-    m_resp->put_U32(thisEventRating);
+    PutListValue(thisEventID);
+    PutListTime(previousTime, thisEventTime);
+    PutListValue(thisEventDuration);
+    PutListValue(thisEventContent);
+    PutListValue(thisEventRating);
 
-    m_resp->put_String(m_toUTF8.Convert(thisEventTitle));
-    m_resp->put_String(m_toUTF8.Convert(thisEventSubTitle));
-    m_resp->put_String(m_toUTF8.Convert(thisEventDescription));
+    PutListString(strings, m_toUTF8.Convert(thisEventTitle));
+    PutListString(strings, m_toUTF8.Convert(thisEventSubTitle));
+    PutListString(strings, m_toUTF8.Convert(thisEventDescription));
 
     atLeastOneEvent = true;
   }
@@ -1847,11 +2076,11 @@ bool cXVDRClient::processEPG_GetForChannel() /* OPCODE 120 */
 
   if (!atLeastOneEvent)
   {
-    m_resp->put_U32(0);
+    PutListValue(0);
     DEBUGLOG("Written 0 because no data");
   }
 
-  m_resp->compress(m_compressionLevel);
+  CompressResponse();
 
   return true;
 }
@@ -36,11 +36,14 @@
 #include <vdr/status.h>
 
 #include "demuxer/demuxer.h"
+#include "net/msgcompressor.h"
 
 class cChannel;
 class cDevice;
 class cLiveStreamer;
 class MsgPacket;
+class MsgReader;
+class MsgStringTable;
 class cRecPlayer;
 class cCmdControl;
 
@@ -58,12 +61,16 @@ private:
   cRecPlayer      *m_RecPlayer;
   MsgPacket       *m_req;
   MsgPacket       *m_resp;
+  MsgReader       *m_reader;
   cCharSetConv     m_toUTF8;
   uint32_t         m_protocolVersion;
   cMutex           m_msgLock;
   static cMutex    m_timerLock;
   static cMutex    m_switchLock;
   int              m_compressionLevel;
+  uint32_t         m_codecs;
+  uint32_t         m_features;
+  MsgCompressor    m_compressor;
   int              m_LanguageIndex;
   eStreamType      m_LangStreamType;
   std::list<int>   m_caids;
@@ -97,7 +104,7 @@ protected:
 
   void SetLoggedIn(bool yesNo) { m_loggedIn = yesNo; }
   void SetStatusInterface(bool yesNo) { m_StatusInterfaceEnabled = yesNo; }
-  bool StartChannelStreaming(const cChannel *channel, uint32_t timeout, int32_t priority);
+  bool StartChannelStreaming(const cChannel *channel, uint32_t timeout, int32_t priority, int profile);
   void StopChannelStreaming();
 
 private:
@@ -114,6 +121,11 @@ private:
   bool IsChannelWanted(cChannel* channel, bool radio = false);
   int  ChannelsCount();
   cString CreateLogoURL(cChannel* channel);
+  int  GetCodec(uint16_t opcode);
+  void CompressResponse();
+  void PutListValue(uint32_t value);
+  void PutListTime(time_t& previous, time_t value);
+  void PutListString(MsgStringTable& strings, const char* value);
 
   bool process_Login();
   bool process_GetTime();
@@ -126,6 +138,9 @@ private:
   bool processChannelStream_Close();
   bool processChannelStream_Pause();
   bool processChannelStream_Request();
+  bool processChannelStream_Seek();
+  bool processChannelStream_Range();
+  bool processChannelStream_KeyFrame();
 
   bool processRecStream_Open();
   bool processRecStream_Close();
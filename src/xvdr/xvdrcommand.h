@@ -27,7 +27,16 @@
 #define XVDR_COMMAND_H
 
 /** Current XVDR Protocol Version number */
-#define XVDR_PROTOCOLVERSION          4
+#define XVDR_PROTOCOLVERSION          5
+
+
+/** Protocol features (negotiated at login) */
+#define XVDR_FEATURE_NOHEADERCHECKSUM 0x00000001
+#define XVDR_FEATURE_COMPACTLISTS     0x00000002 /* protocol version 5 */
+#define XVDR_FEATURE_QUEUESTATUS      0x00000004 /* send XVDR_STREAM_QUEUESTATUS every second */
+
+/** All features supported by this server */
+#define XVDR_FEATURES                 (XVDR_FEATURE_NOHEADERCHECKSUM | XVDR_FEATURE_COMPACTLISTS | XVDR_FEATURE_QUEUESTATUS)
 
 
 /** Packet types */
@@ -51,7 +60,10 @@
 #define XVDR_CHANNELSTREAM_OPEN    20
 #define XVDR_CHANNELSTREAM_CLOSE   21
 #define XVDR_CHANNELSTREAM_REQUEST 22
-#define XVDR_CHANNELSTREAM_PAUSE   23
+#define XVDR_CHANNELSTREAM_PAUSE   23 /* U32 on, optional U8 spill (write the buffer to disk) */
+#define XVDR_CHANNELSTREAM_SEEK    24 /* U8 relative, S64 time (ms since the epoch or ms relative to the read position) */
+#define XVDR_CHANNELSTREAM_RANGE   25 /* -> S64 first, last, current time (ms), S64 first, last, current pts */
+#define XVDR_CHANNELSTREAM_KEYFRAME 26 /* S32 direction (>= 0 forward) */
 
 /* OPCODE 40 - 59: XVDR network functions for recording streaming */
 #define XVDR_RECSTREAM_OPEN        40
@@ -101,10 +113,16 @@
 /** Stream packet types (server -> client) */
 #define XVDR_STREAM_CHANGE       1
 #define XVDR_STREAM_STATUS       2
-#define XVDR_STREAM_QUEUESTATUS  3
+#define XVDR_STREAM_QUEUESTATUS  3  /* U32 throughput (bytes/s), U32 queued packets, U32 queued bytes, U32 queue delay (ms),
+                                        U32 socket queue (bytes), U32 socket delay (ms), U32 dropped packets, U32 resyncs */
 #define XVDR_STREAM_MUXPKT       4
 #define XVDR_STREAM_SIGNALINFO   5
 #define XVDR_STREAM_CONTENTINFO  6
+#define XVDR_STREAM_RESYNC       7  /* S64 pts of the keyframe, U32 skipped packets */
+
+/** Stream profiles (sent with XVDR_CHANNELSTREAM_OPEN) */
+#define XVDR_STREAM_PROFILE_LOWLATENCY 0
+#define XVDR_STREAM_PROFILE_THROUGHPUT 1
 
 /** Stream status codes */
 #define XVDR_STREAM_STATUS_SIGNALLOST     111
@@ -42,8 +42,12 @@
 
 #include "xvdrserver.h"
 #include "xvdrclient.h"
+#include "live/livesender.h"
 #include "recordings/recordingscache.h"
 #include "net/os-config.h"
+#include "net/crc32.h"
+#include "net/msgpool.h"
+#include "net/uring.h"
 
 //#define ENABLE_CHANNELTRIGGER 1
 
@@ -135,6 +139,8 @@ cXVDRServer::cXVDRServer(int listenPort) : cThread("VDR XVDR Server")
 
   INFOLOG("XVDR Server started");
   INFOLOG("Channel streaming timeout: %i seconds", XVDRServerConfig.stream_timeout);
+  INFOLOG("CRC32 engine: %s", crc32_engine_name());
+  INFOLOG("Transmit backend: %s", uring_supported() ? "io_uring" : "poll/sendmsg");
   return;
 }
 
@@ -147,6 +153,7 @@ cXVDRServer::~cXVDRServer()
   }
   m_clients.erase(m_clients.begin(), m_clients.end());
   Cancel();
+  cLiveSender::Shutdown();
   INFOLOG("XVDR Server stopped");
 }
 
@@ -257,6 +264,10 @@ void cXVDRServer::Action(void)
           INFOLOG("Client with ID %u seems to be disconnected, removing from client list", (*i)->GetID());
           delete (*i);
           i = m_clients.erase(i);
+
+          uint64_t hits, misses;
+          MsgPool::getStats(hits, misses);
+          INFOLOG("Packet pool: %llu hits, %llu misses", (unsigned long long)hits, (unsigned long long)misses);
         }
         else {
           i++;
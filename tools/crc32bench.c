@@ -0,0 +1,105 @@
+/*
+ *      XVDR CRC32 Benchmark
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "net/crc32.h"
+
+// size of a packet header without the checksum itself
+#define HEADER_SIZE 28
+
+// size of a recording block
+#define BLOCK_SIZE (256 * 1024)
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench(const crc32_engine* e, const uint8_t* data, size_t size, int loops) {
+	volatile uint32_t crc = 0;
+
+	double start = now();
+
+	for(int i = 0; i < loops; i++) {
+		crc = e->update(crc, data, size);
+	}
+
+	double elapsed = now() - start;
+	double ns = elapsed * 1e9 / loops;
+	double mbs = (double)size * loops / elapsed / (1024 * 1024);
+
+	printf("%-8s %8zu bytes: %10.1f ns/op %10.1f MB/s\n", e->name, size, ns, mbs);
+}
+
+int main(int argc, char* argv[]) {
+	uint8_t* data = (uint8_t*)malloc(BLOCK_SIZE + 1);
+
+	srand(4711);
+
+	for(int i = 0; i < BLOCK_SIZE + 1; i++) {
+		data[i] = rand();
+	}
+
+	printf("active engine: %s\n\n", crc32_engine_name());
+
+	// the reference is the classic table implementation
+	const crc32_engine* ref = NULL;
+
+	for(const crc32_engine* e = crc32_engines(); e->name != NULL; e++) {
+		if(strcmp(e->name, "table") == 0) {
+			ref = e;
+		}
+	}
+
+	int rc = 0;
+
+	for(const crc32_engine* e = crc32_engines(); e->name != NULL; e++) {
+		if(!e->supported()) {
+			printf("%-8s not supported on this CPU\n", e->name);
+			continue;
+		}
+
+		// verify against the reference (odd sizes and unaligned data included)
+		for(size_t size = 0; size <= 1024; size++) {
+			for(int offset = 0; offset < 2; offset++) {
+				if(e->update(0xFFFFFFFF, data + offset, size) != ref->update(0xFFFFFFFF, data + offset, size)) {
+					printf("%-8s MISMATCH at size %zu, offset %i\n", e->name, size, offset);
+					rc = 1;
+				}
+			}
+		}
+
+		bench(e, data, HEADER_SIZE, 10000000);
+		bench(e, data, BLOCK_SIZE, 2000);
+	}
+
+	free(data);
+	return rc;
+}
@@ -0,0 +1,413 @@
+/*
+ *      XVDR MsgPacket Benchmark
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "net/msgpacket.h"
+#include "net/msgcompressor.h"
+#include "net/msgreader.h"
+
+// payload shapes
+#define SHAPE_FRAME    0
+#define SHAPE_CHANNELS 1
+#define SHAPE_EPG      2
+#define SHAPES         3
+
+static const char* shapename[SHAPES] = { "frame", "channels", "epg" };
+
+// size of a video frame (roughly a SD I-frame)
+#define FRAME_SIZE (48 * 1024)
+
+// number of entries in the lists
+#define CHANNEL_COUNT 500
+#define EPG_COUNT     300
+
+// stream packets sent over the socketpair
+#define STREAM_COUNT 20000
+
+static uint8_t frame[FRAME_SIZE];
+
+static uint8_t framecopy[FRAME_SIZE];
+
+static int failures = 0;
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char* name, const char* shape, double elapsed, int loops, uint64_t bytes) {
+	double ns = elapsed * 1e9 / loops;
+	double mbs = (double)bytes / elapsed / (1024 * 1024);
+
+	printf("%-24s %-9s %12.1f ns/op %10.1f MB/s\n", name, shape, ns, mbs);
+}
+
+// live stream packet (see cLiveStreamer::sendStreamPacket)
+static void put_frame(MsgPacket* p, int i) {
+	p->put_U16(0x100 + (i & 3));
+	p->put_S64(900000 + i * 3600);
+	p->put_S64(900000 + i * 3600 - 7200);
+	p->put_U32(FRAME_SIZE);
+	p->put_Blob(frame, FRAME_SIZE);
+}
+
+// channel list (see cXVDRClient::processCHANNELS_GetChannels)
+static void put_channels(MsgPacket* p) {
+	static const char* names[] = { "Das Erste HD", "ZDF HD", "arte HD", "3sat", "BR Fernsehen Süd", "Phoenix", "KiKA", "ORF1 HD" };
+	char name[64];
+	char logo[128];
+
+	for(int i = 0; i < CHANNEL_COUNT; i++) {
+		snprintf(name, sizeof(name), "%s %i", names[i & 7], i);
+		snprintf(logo, sizeof(logo), "http://192.168.16.1/picons/1_0_19_%X_%X_1_C00000_0_0_0.png", 0x283D + i, 0x3FB + (i & 15));
+
+		p->put_U32(i + 1);
+		p->put_String(name);
+		p->put_U32(0x12345678u * (i + 1));
+		p->put_U32((i & 3) ? 0 : 0x1702);
+		p->put_String(logo);
+	}
+}
+
+// epg events (see cXVDRClient::processEPG_GetForChannel)
+static void put_epg(MsgPacket* p) {
+	static const char* titles[] = { "Tagesschau", "Tatort", "Sportschau", "Wetter vor acht", "Lindenstraße", "Tagesthemen" };
+	static const char* description =
+		"Kommissar Thiel und Professor Boerne ermitteln in einem neuen Fall. "
+		"Ein Toter im Stadthafen gibt den beiden Ermittlern Rätsel auf, denn "
+		"niemand scheint den Mann vermisst zu haben. Die Spur führt schließlich "
+		"in die Vergangenheit des Rechtsmediziners.";
+
+	for(int i = 0; i < EPG_COUNT; i++) {
+		p->put_U32(1000 + i);
+		p->put_U32(1350000000 + i * 1800);
+		p->put_U32(1800);
+		p->put_U32(0x10 + (i & 7));
+		p->put_U32(0);
+		p->put_String(titles[i % 6]);
+		p->put_String((i & 1) ? "Folge 1234" : "");
+		p->put_String(description);
+	}
+}
+
+static void put_shape(MsgPacket* p, int shape, int i) {
+	switch(shape) {
+		case SHAPE_FRAME:
+			put_frame(p, i);
+			break;
+		case SHAPE_CHANNELS:
+			put_channels(p);
+			break;
+		case SHAPE_EPG:
+			put_epg(p);
+			break;
+	}
+}
+
+// read all fields back, like a client does
+static void get_shape(MsgPacket* p, int shape) {
+	switch(shape) {
+		case SHAPE_FRAME: {
+			p->get_U16();
+			p->get_S64();
+			p->get_S64();
+			p->get_U32();
+			p->get_Blob(framecopy, FRAME_SIZE);
+			break;
+		}
+		case SHAPE_CHANNELS:
+			while(!p->eop()) {
+				p->get_U32();
+				p->get_String();
+				p->get_U32();
+				p->get_U32();
+				p->get_String();
+			}
+			break;
+		case SHAPE_EPG:
+			while(!p->eop()) {
+				p->get_U32();
+				p->get_U32();
+				p->get_U32();
+				p->get_U32();
+				p->get_U32();
+				p->get_String();
+				p->get_String();
+				p->get_String();
+			}
+			break;
+	}
+}
+
+static int loops_for(int shape) {
+	return (shape == SHAPE_FRAME) ? 20000 : 2000;
+}
+
+static void bench_put(int shape) {
+	int loops = loops_for(shape);
+	uint64_t bytes = 0;
+
+	double start = now();
+
+	for(int i = 0; i < loops; i++) {
+		MsgPacket p(1);
+		put_shape(&p, shape, i);
+		bytes += p.getPayloadLength();
+	}
+
+	report("put", shapename[shape], now() - start, loops, bytes);
+}
+
+static void bench_get(int shape) {
+	int loops = loops_for(shape);
+	uint64_t bytes = 0;
+
+	MsgPacket p(1);
+	put_shape(&p, shape, 0);
+
+	double start = now();
+
+	for(int i = 0; i < loops; i++) {
+		p.rewind();
+		get_shape(&p, shape);
+		bytes += p.getPayloadLength();
+	}
+
+	report("get", shapename[shape], now() - start, loops, bytes);
+}
+
+static void bench_freeze(int shape, bool payloadchecksum) {
+	int loops = loops_for(shape);
+	uint64_t bytes = 0;
+	double elapsed = 0;
+
+	for(int i = 0; i < loops; i++) {
+		MsgPacket p(1);
+		put_shape(&p, shape, i);
+
+		if(!payloadchecksum) {
+			p.disablePayloadCheckSum();
+		}
+
+		double start = now();
+		p.freeze();
+		elapsed += now() - start;
+
+		bytes += p.getPacketLength();
+	}
+
+	report(payloadchecksum ? "freeze+crc" : "freeze", shapename[shape], elapsed, loops, bytes);
+}
+
+static void bench_codec(int shape, int codec, int level) {
+	int loops = loops_for(shape) / 10;
+	uint64_t bytes = 0;
+	uint64_t compressedbytes = 0;
+	double compresstime = 0;
+	double uncompresstime = 0;
+
+	MsgCompressor writer(level);
+	MsgCompressor reader;
+
+	for(int i = 0; i < loops; i++) {
+		MsgPacket p(1);
+		put_shape(&p, shape, i);
+
+		uint32_t size = p.getPayloadLength();
+		double start = now();
+
+		bool rc = (codec == MsgPacket::CodecZlibStream) ? writer.compress(&p) : p.compress(level, codec);
+
+		compresstime += now() - start;
+
+		if(!rc) {
+			failures++;
+			return;
+		}
+
+		compressedbytes += p.getPayloadLength();
+		start = now();
+
+		rc = (codec == MsgPacket::CodecZlibStream) ? reader.uncompress(&p) : p.uncompress();
+
+		uncompresstime += now() - start;
+
+		if(!rc || p.getPayloadLength() != size) {
+			failures++;
+			return;
+		}
+
+		bytes += size;
+	}
+
+	static const char* codecname[] = { "zlib", "lz4", "zstd", "zlibstream" };
+	char name[32];
+
+	snprintf(name, sizeof(name), "compress %s-%i", codecname[codec], level);
+	report(name, shapename[shape], compresstime, loops, bytes);
+
+	snprintf(name, sizeof(name), "uncompress %s-%i", codecname[codec], level);
+	report(name, shapename[shape], uncompresstime, loops, bytes);
+
+	printf("%-24s %-9s %12.1f %%\n", "ratio", shapename[shape], compressedbytes * 100.0 / bytes);
+}
+
+struct StreamParam {
+	int fd;
+	int batch;
+};
+
+static void* stream_writer(void* data) {
+	StreamParam* param = (StreamParam*)data;
+	MsgPacket* batch[64];
+	int count = 0;
+
+	for(int i = 0; i < STREAM_COUNT; i++) {
+		MsgPacket* p = new MsgPacket(1, 2);
+		p->disablePayloadCheckSum();
+		put_frame(p, i);
+		batch[count++] = p;
+
+		if(count < param->batch && i < STREAM_COUNT - 1) {
+			continue;
+		}
+
+		bool rc = (count == 1) ? batch[0]->write(param->fd, 10000) : MsgPacket::write(param->fd, batch, count, 10000);
+
+		if(!rc) {
+			failures++;
+		}
+
+		for(int n = 0; n < count; n++) {
+			delete batch[n];
+		}
+
+		count = 0;
+	}
+
+	return NULL;
+}
+
+static void bench_socket(int batch, bool buffered) {
+	int fd[2];
+
+	if(socketpair(AF_UNIX, SOCK_STREAM, 0, fd) == -1) {
+		perror("socketpair");
+		failures++;
+		return;
+	}
+
+	StreamParam param = { fd[0], batch };
+	pthread_t thread;
+
+	double start = now();
+	pthread_create(&thread, NULL, stream_writer, &param);
+
+	MsgReader reader(fd[1]);
+	uint64_t bytes = 0;
+	int received = 0;
+
+	while(received < STREAM_COUNT) {
+		bool closed = false;
+		MsgPacket* p = buffered ? reader.read(closed, 10000) : MsgPacket::read(fd[1], closed, 10000);
+
+		if(p == NULL) {
+			failures++;
+			break;
+		}
+
+		bytes += p->getPacketLength();
+		received++;
+		delete p;
+	}
+
+	double elapsed = now() - start;
+	pthread_join(thread, NULL);
+
+	close(fd[0]);
+	close(fd[1]);
+
+	char name[32];
+	snprintf(name, sizeof(name), "write/%i %s", batch, buffered ? "msgreader" : "read");
+	report(name, "frame", elapsed, received, bytes);
+}
+
+int main(int argc, char* argv[]) {
+	srand(4711);
+
+	// video frames hardly compress
+	for(int i = 0; i < FRAME_SIZE; i++) {
+		frame[i] = rand();
+	}
+
+	for(int shape = 0; shape < SHAPES; shape++) {
+		bench_put(shape);
+		bench_get(shape);
+		bench_freeze(shape, false);
+		bench_freeze(shape, true);
+	}
+
+	printf("\n");
+
+	uint32_t codecs = MsgPacket::getCodecs();
+
+	for(int shape = SHAPE_CHANNELS; shape < SHAPES; shape++) {
+		for(int codec = MsgPacket::CodecZlib; codec <= MsgPacket::CodecZlibStream; codec++) {
+			if(!(codecs & (1 << codec))) {
+				continue;
+			}
+
+			// lz4 doesn't have compression levels
+			for(int level = 1; level <= 9; level++) {
+				if(codec == MsgPacket::CodecLZ4 && level > 1) {
+					break;
+				}
+
+				bench_codec(shape, codec, level);
+			}
+		}
+	}
+
+	printf("\n");
+
+	bench_socket(1, false);
+	bench_socket(1, true);
+	bench_socket(64, true);
+
+	if(failures > 0) {
+		printf("\n%i FAILURES\n", failures);
+		return 1;
+	}
+
+	return 0;
+}